@@ -0,0 +1,536 @@
+// Micro- and macrobenchmarks of the paths main spends its time on, reported as JSON so results can be compared
+// across builds.
+//
+//   bench [--filter=<substring>] [--repetitions=<n>] [--output=<file>]
+//
+// Inputs are generated deterministically, so runs on the same machine and build are comparable. Every benchmark runs
+// once to warm up and then --repetitions times; min, median and mean are reported per iteration.
+#include "luau_analyzer.hpp"
+#include "luau_require_cache.hpp"
+#include "luau_runtime.hpp"
+#include "luau_utils.hpp"
+
+#include "lua.h"
+#include "lualib.h"
+
+#include "Luau/Compiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+struct Result
+{
+    std::string name;
+    size_t iterations = 0;
+    std::vector<double> seconds;
+    // work per iteration for throughput: bytes for compilation, items otherwise
+    double bytes = 0;
+    double items = 0;
+};
+
+struct Options
+{
+    std::string filter;
+    int repetitions = 10;
+    std::string output;
+};
+
+Options options;
+std::vector<Result> results;
+
+// Runs body(iterations) once to warm up and then options.repetitions times, recording the time of each repetition
+void measure(const std::string& name, size_t iterations, const std::function<void(size_t)>& body, double bytes = 0, double items = 0)
+{
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+        return;
+
+    fprintf(stderr, "%s...\n", name.c_str());
+
+    body(iterations);
+
+    Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.bytes = bytes;
+    result.items = items;
+
+    for (int i = 0; i < options.repetitions; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        body(iterations);
+        result.seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    results.push_back(std::move(result));
+}
+
+// A module of count functions with loops, tables, closures and string work, roughly like application code
+std::string makeSource(int count)
+{
+    std::string source = "local M = {}\n\n";
+
+    for (int i = 0; i < count; i++)
+    {
+        std::string n = std::to_string(i);
+
+        source += "function M.f" + n + "(items: {number}, scale: number): number\n";
+        source += "    local total = 0\n";
+        source += "    for index, value in items do\n";
+        source += "        if value % 2 == 0 then\n";
+        source += "            total += value * scale\n";
+        source += "        elseif index > " + n + " then\n";
+        source += "            total -= math.floor(value / scale)\n";
+        source += "        end\n";
+        source += "    end\n";
+        source += "    local parts = {}\n";
+        source += "    for k = 1, 8 do\n";
+        source += "        table.insert(parts, string.format(\"%d:%d\", k, total))\n";
+        source += "    end\n";
+        source += "    local join = function(sep) return table.concat(parts, sep) end\n";
+        source += "    return #join(\",\") + total\n";
+        source += "end\n\n";
+    }
+
+    source += "return M\n";
+    return source;
+}
+
+void writeFile(const std::filesystem::path& path, const std::string& contents)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << contents;
+}
+
+// Scratch directory for generated modules, removed at exit
+struct TempDirectory
+{
+    std::filesystem::path path;
+
+    TempDirectory()
+        : path(std::filesystem::temp_directory_path() / ("luau-bench-" + std::to_string(getpid())))
+    {
+        std::filesystem::create_directories(path);
+    }
+
+    ~TempDirectory()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+};
+
+void benchCompile()
+{
+    std::string source = makeSource(200);
+
+    for (int level = 0; level <= 2; level++)
+    {
+        Luau::CompileOptions copts;
+        copts.optimizationLevel = level;
+        copts.debugLevel = 1;
+
+        measure(
+            "compile/O" + std::to_string(level),
+            10,
+            [&](size_t iterations)
+            {
+                for (size_t i = 0; i < iterations; i++)
+                    Luau::compile(source, copts);
+            },
+            double(source.size())
+        );
+    }
+}
+
+void benchLoad()
+{
+    std::string bytecode = Luau::compile(makeSource(200), LuauUtils::copts());
+
+    lua_State* L = luaL_newstate();
+
+    measure(
+        "luau_load",
+        100,
+        [&](size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; i++)
+            {
+                luau_load(L, "=bench", bytecode.data(), bytecode.size(), 0);
+                lua_pop(L, 1);
+            }
+
+            lua_gc(L, LUA_GCCOLLECT, 0);
+        },
+        double(bytecode.size())
+    );
+
+    lua_close(L);
+}
+
+void benchState()
+{
+    measure(
+        "state/luaL_newstate+openlibs",
+        1000,
+        [](size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; i++)
+            {
+                lua_State* L = luaL_newstate();
+                luaL_openlibs(L);
+                lua_close(L);
+            }
+        }
+    );
+
+    measure(
+        "state/createState",
+        1000,
+        [](size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; i++)
+                LuauUtils::closeState(LuauUtils::createState());
+        }
+    );
+}
+
+void benchLoadstring()
+{
+    lua_State* L = LuauUtils::createState();
+
+    // small chunks like the ones scripts build at runtime
+    std::vector<std::string> chunks;
+    for (int i = 0; i < 64; i++)
+        chunks.push_back("local a, b = ...\nreturn a * " + std::to_string(i) + " + (b or 0)");
+
+    auto body = [&](size_t iterations)
+    {
+        for (size_t i = 0; i < iterations; i++)
+        {
+            lua_getglobal(L, "loadstring");
+            lua_pushlstring(L, chunks[i % chunks.size()].data(), chunks[i % chunks.size()].size());
+            lua_call(L, 1, 1);
+            lua_pop(L, 1);
+        }
+
+        lua_gc(L, LUA_GCCOLLECT, 0);
+    };
+
+    measure("loadstring/compile", 1000, body, 0, 1);
+
+    LuauUtils::chunkCache = std::make_unique<LuauUtils::ChunkCache>(LuauUtils::globalOptions.chunkCacheSize);
+    measure("loadstring/cached", 1000, body, 0, 1);
+    LuauUtils::chunkCache.reset();
+
+    LuauUtils::closeState(L);
+}
+
+void benchRequire(const std::filesystem::path& root)
+{
+    constexpr int moduleCount = 32;
+
+    std::filesystem::path dir = root / "require";
+    std::filesystem::create_directories(dir);
+
+    std::string script;
+    for (int i = 0; i < moduleCount; i++)
+    {
+        writeFile(dir / ("mod" + std::to_string(i) + ".luau"), makeSource(10));
+        script += "local m" + std::to_string(i) + " = require(\"./mod" + std::to_string(i) + "\")\n";
+    }
+
+    std::string chunkname = "@" + (dir / "main.luau").string();
+
+    // a fresh state and require cache each time, so every module is resolved, read, compiled and run; includes
+    // state/createState
+    measure(
+        "require/cold",
+        10,
+        [&](size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; i++)
+            {
+                LuauUtils::sharedRequireCache().clear();
+
+                lua_State* L = LuauUtils::createState();
+                LuauUtils::runScript(L, script, false, chunkname, nullptr);
+                LuauUtils::closeState(L);
+            }
+        },
+        0,
+        moduleCount
+    );
+
+    // the same state, so every require after the first run is answered from _MODULES
+    lua_State* L = LuauUtils::createState();
+    LuauUtils::runScript(L, script, false, chunkname, nullptr);
+
+    measure(
+        "require/cached",
+        100,
+        [&](size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; i++)
+                LuauUtils::runScript(L, script, false, chunkname, nullptr);
+        },
+        0,
+        moduleCount
+    );
+
+    LuauUtils::closeState(L);
+}
+
+// Writes a graph of count modules where module i requires the modules edges(i) returns and returns the entry point
+std::string makeGraph(const std::filesystem::path& dir, int count, const std::function<std::vector<int>(int)>& edges)
+{
+    std::filesystem::create_directories(dir);
+
+    for (int i = 0; i < count; i++)
+    {
+        std::string source;
+        for (int dependency : edges(i))
+            source += "local d" + std::to_string(dependency) + " = require(\"./m" + std::to_string(dependency) + "\")\n";
+
+        source += makeSource(5);
+        writeFile(dir / ("m" + std::to_string(i) + ".luau"), source);
+    }
+
+    return (dir / "m0.luau").string();
+}
+
+void benchAnalyze(const std::filesystem::path& root)
+{
+    constexpr int moduleCount = 64;
+
+    struct Graph
+    {
+        const char* name;
+        std::function<std::vector<int>(int)> edges;
+    };
+
+    Graph graphs[] = {
+        // one long dependency chain, which can't be checked in parallel
+        {"chain",
+            [](int i)
+            {
+                return i + 1 < moduleCount ? std::vector<int>{i + 1} : std::vector<int>{};
+            }},
+        // a binary tree, wide enough to keep every worker busy
+        {"tree",
+            [](int i)
+            {
+                std::vector<int> children;
+                for (int child = 2 * i + 1; child <= 2 * i + 2 && child < moduleCount; child++)
+                    children.push_back(child);
+                return children;
+            }},
+        // layers of 8 where every module requires the whole next layer
+        {"lattice",
+            [](int i)
+            {
+                std::vector<int> next;
+                int layer = i / 8;
+                for (int j = (layer + 1) * 8; j < (layer + 2) * 8 && j < moduleCount; j++)
+                    next.push_back(j);
+                return next;
+            }},
+    };
+
+    for (const Graph& graph : graphs)
+    {
+        std::string entry = makeGraph(root / "analyze" / graph.name, moduleCount, graph.edges);
+
+        measure(
+            std::string("analyze/") + graph.name,
+            1,
+            [&](size_t iterations)
+            {
+                for (size_t i = 0; i < iterations; i++)
+                {
+                    // resolution is part of what is measured, so nothing is answered from an earlier iteration
+                    LuauUtils::sharedRequireCache().clear();
+                    LuauUtils::analyzeLuau(std::vector<std::string>{entry});
+                }
+            },
+            0,
+            moduleCount
+        );
+    }
+}
+
+void benchScheduler()
+{
+    constexpr size_t tasksPerProducer = 50000;
+
+    for (unsigned producers : {1u, 4u, 16u})
+    {
+        unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+
+        measure(
+            "scheduler/push-pop/" + std::to_string(producers) + "x" + std::to_string(workers),
+            1,
+            [&](size_t iterations)
+            {
+                for (size_t i = 0; i < iterations; i++)
+                {
+                    std::atomic<size_t> done{0};
+                    size_t total = tasksPerProducer * producers;
+
+                    {
+                        LuauUtils::TaskScheduler scheduler(workers);
+
+                        std::vector<std::thread> threads;
+                        for (unsigned p = 0; p < producers; p++)
+                        {
+                            threads.emplace_back(
+                                [&]
+                                {
+                                    // empty tasks, so the queue lock is all that is measured
+                                    for (size_t t = 0; t < tasksPerProducer; t++)
+                                    {
+                                        scheduler.push(
+                                            [&done]
+                                            {
+                                                done.fetch_add(1, std::memory_order_relaxed);
+                                            }
+                                        );
+                                    }
+                                }
+                            );
+                        }
+
+                        for (std::thread& thread : threads)
+                            thread.join();
+
+                        while (done.load(std::memory_order_relaxed) < total)
+                            std::this_thread::yield();
+                    }
+                }
+            },
+            0,
+            double(tasksPerProducer * producers)
+        );
+    }
+}
+
+std::string escape(const std::string& value)
+{
+    std::string result;
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+void writeJson(FILE* out)
+{
+    char date[64] = {};
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"context\": {\n");
+    fprintf(out, "    \"date\": \"%s\",\n", date);
+    fprintf(out, "    \"build_id\": \"%s\",\n", escape(LuauUtils::globalOptions.buildId).c_str());
+    fprintf(out, "    \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(out, "    \"repetitions\": %d\n", options.repetitions);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"benchmarks\": [");
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& result = results[i];
+
+        std::vector<double> sorted = result.seconds;
+        std::sort(sorted.begin(), sorted.end());
+
+        double perIteration = 1e9 / double(result.iterations);
+        double min = sorted.front() * perIteration;
+        double median = sorted[sorted.size() / 2] * perIteration;
+        double mean = 0;
+        for (double seconds : sorted)
+            mean += seconds * perIteration / double(sorted.size());
+
+        fprintf(out, "%s\n    {\n", i ? "," : "");
+        fprintf(out, "      \"name\": \"%s\",\n", escape(result.name).c_str());
+        fprintf(out, "      \"iterations\": %zu,\n", result.iterations);
+        fprintf(out, "      \"min_ns\": %.0f,\n", min);
+        fprintf(out, "      \"median_ns\": %.0f,\n", median);
+        fprintf(out, "      \"mean_ns\": %.0f", mean);
+
+        // throughput from the median, which is less noisy than the mean
+        if (result.bytes > 0)
+            fprintf(out, ",\n      \"bytes_per_second\": %.0f", result.bytes * 1e9 / median);
+        if (result.items > 0)
+            fprintf(out, ",\n      \"items_per_second\": %.0f", result.items * 1e9 / median);
+
+        fprintf(out, "\n    }");
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg.substr(0, 9) == "--filter=")
+            options.filter = arg.substr(9);
+        else if (arg.substr(0, 14) == "--repetitions=")
+            options.repetitions = std::max(atoi(arg.substr(14).c_str()), 1);
+        else if (arg.substr(0, 9) == "--output=")
+            options.output = arg.substr(9);
+        else
+        {
+            fprintf(stderr, "Usage: %s [--filter=<substring>] [--repetitions=<n>] [--output=<file>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    LuauUtils::globalOptions.buildId = LuauUtils::BytecodeCache::currentBuildId(argv[0]);
+
+    TempDirectory temp;
+
+    benchCompile();
+    benchLoad();
+    benchState();
+    benchLoadstring();
+    benchRequire(temp.path);
+    benchAnalyze(temp.path);
+    benchScheduler();
+
+    FILE* out = options.output.empty() ? stdout : fopen(options.output.c_str(), "w");
+    if (!out)
+    {
+        fprintf(stderr, "Could not open %s\n", options.output.c_str());
+        return 1;
+    }
+
+    writeJson(out);
+
+    if (out != stdout)
+        fclose(out);
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+// Compares LuauUtils::TaskScheduler with LuauUtils::WorkStealingScheduler at 1 to 64 threads.
+//
+// Two workloads are measured:
+//   flat   - one external thread pushes every task, like Frontend::checkQueuedModules does
+//   nested - tasks push their own children, which exercises worker-local queues and stealing
+#include "luau_utils.hpp"
+#include "luau_work_stealing.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+
+namespace {
+
+constexpr unsigned kThreadCounts[] = {1, 2, 4, 8, 16, 32, 64};
+constexpr int kRepetitions = 5;
+
+// Stand-in for a small unit of work so tasks aren't pure scheduling overhead
+void spinWork(unsigned iterations)
+{
+    volatile unsigned sink = 0;
+    for (unsigned i = 0; i < iterations; i++)
+        sink = sink + i;
+}
+
+void waitFor(const std::atomic<size_t>& counter, size_t target)
+{
+    while (counter.load(std::memory_order_acquire) < target)
+        std::this_thread::yield();
+}
+
+template<typename Scheduler>
+double runFlat(unsigned threads, size_t taskCount, unsigned work)
+{
+    std::atomic<size_t> done{0};
+    Scheduler scheduler(threads);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < taskCount; i++)
+    {
+        scheduler.push(std::function<void()>(
+            [&done, work]
+            {
+                spinWork(work);
+                done.fetch_add(1, std::memory_order_release);
+            }
+        ));
+    }
+
+    waitFor(done, taskCount);
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<typename Scheduler>
+void spawnTree(Scheduler& scheduler, std::atomic<size_t>& done, unsigned depth, unsigned work)
+{
+    spinWork(work);
+
+    if (depth > 0)
+    {
+        for (int child = 0; child < 2; child++)
+        {
+            scheduler.push(std::function<void()>(
+                [&scheduler, &done, depth, work]
+                {
+                    spawnTree(scheduler, done, depth - 1, work);
+                }
+            ));
+        }
+    }
+
+    done.fetch_add(1, std::memory_order_release);
+}
+
+template<typename Scheduler>
+double runNested(unsigned threads, unsigned depth, unsigned work)
+{
+    std::atomic<size_t> done{0};
+    size_t taskCount = (size_t(1) << (depth + 1)) - 1;
+
+    Scheduler scheduler(threads);
+
+    auto start = std::chrono::steady_clock::now();
+
+    scheduler.push(std::function<void()>(
+        [&scheduler, &done, depth, work]
+        {
+            spawnTree(scheduler, done, depth, work);
+        }
+    ));
+
+    waitFor(done, taskCount);
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<typename F>
+double best(F&& f)
+{
+    double result = f();
+    for (int i = 1; i < kRepetitions; i++)
+        result = std::min(result, f());
+    return result;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    size_t taskCount = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+    unsigned work = argc > 2 ? unsigned(strtoul(argv[2], nullptr, 10)) : 200;
+    unsigned depth = 17;
+
+    printf("tasks: %zu flat, %zu nested; work per task: %u iterations; best of %d\n", taskCount, (size_t(1) << (depth + 1)) - 1, work, kRepetitions);
+    printf("%8s %14s %14s %8s %14s %14s %8s\n", "threads", "flat old (ms)", "flat ws (ms)", "speedup", "nest old (ms)", "nest ws (ms)", "speedup");
+
+    for (unsigned threads : kThreadCounts)
+    {
+        double flatOld = best([&] { return runFlat<LuauUtils::TaskScheduler>(threads, taskCount, work); });
+        double flatNew = best([&] { return runFlat<LuauUtils::WorkStealingScheduler>(threads, taskCount, work); });
+        double nestedOld = best([&] { return runNested<LuauUtils::TaskScheduler>(threads, depth, work); });
+        double nestedNew = best([&] { return runNested<LuauUtils::WorkStealingScheduler>(threads, depth, work); });
+
+        printf(
+            "%8u %14.2f %14.2f %7.2fx %14.2f %14.2f %7.2fx\n",
+            threads,
+            flatOld * 1000,
+            flatNew * 1000,
+            flatOld / flatNew,
+            nestedOld * 1000,
+            nestedNew * 1000,
+            nestedOld / nestedNew
+        );
+    }
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+// Compares running short scripts on pooled sandboxed states against creating a fresh state per script,
+// which is what runLuau does.
+#include "luau_runtime.hpp"
+#include "luau_state_pool.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+const char* const kScripts[] = {
+    "local x = 1 + 1",
+    "local t = {} for i = 1, 100 do t[i] = i * 2 end",
+    "local s = {} for i = 1, 50 do s[i] = tostring(i) end local r = table.concat(s, ',')",
+};
+
+template<typename F>
+double timeRuns(int runs, F&& f)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < runs; i++)
+        f(i);
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? atoi(argv[1]) : 10000;
+    constexpr int scriptCount = int(sizeof(kScripts) / sizeof(kScripts[0]));
+
+    double fresh = timeRuns(
+        runs,
+        [](int i)
+        {
+            LuauUtils::runLuau(kScripts[i % scriptCount]);
+        }
+    );
+
+    LuauUtils::StatePool pool(1);
+    pool.warm(1);
+
+    int lost = 0;
+    double pooled = timeRuns(
+        runs,
+        [&](int i)
+        {
+            lost += pool.run(kScripts[i % scriptCount]) == LuauUtils::StatePool::RunStatus::StateLost;
+        }
+    );
+
+    printf("runs: %d\n", runs);
+    printf("%-8s %12s %12s\n", "mode", "total (ms)", "per run (us)");
+    printf("%-8s %12.2f %12.2f\n", "fresh", fresh * 1000, fresh * 1e6 / runs);
+    printf("%-8s %12.2f %12.2f\n", "pooled", pooled * 1000, pooled * 1e6 / runs);
+    printf("speedup: %.2fx, states created by pool: %zu, lost: %d\n", fresh / pooled, pool.getCreatedCount(), lost);
+
+    return 0;
+}
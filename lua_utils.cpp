@@ -1,11 +1,18 @@
 #include "luau_utils.hpp"
+#include "luau_require_cache.hpp"
+#include "luau_source.hpp"
+#include "luau_trace.hpp"
 #include "Luau/Require.h"
 #include "Luau/TypeAttach.h"
 #include "Luau/ToString.h"
 #include "Luau/Transpiler.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
+#include <sys/stat.h>
+
 
 
 namespace LuauUtils {
@@ -36,28 +43,43 @@ void report(ReportFormat format, const char* name, const Luau::Location& loc, co
     }
 }
 
-void reportError(const Luau::Frontend& frontend, ReportFormat format, const Luau::TypeError& error)
+void report(ReportFormat format, const Diagnostic& diagnostic)
+{
+    report(format, diagnostic.name.c_str(), diagnostic.location, diagnostic.type.c_str(), diagnostic.message.c_str());
+}
+
+void reportError(const Luau::Frontend& frontend, ReportFormat format, const Luau::TypeError& error, std::vector<Diagnostic>* diagnostics)
 {
-    std::string humanReadableName = frontend.fileResolver->getHumanReadableModuleName(error.moduleName);
+    Diagnostic diagnostic;
+    diagnostic.name = frontend.fileResolver->getHumanReadableModuleName(error.moduleName);
+    diagnostic.location = error.location;
 
     if (const Luau::SyntaxError* syntaxError = Luau::get_if<Luau::SyntaxError>(&error.data))
-        report(format, humanReadableName.c_str(), error.location, "SyntaxError", syntaxError->message.c_str());
+    {
+        diagnostic.type = "SyntaxError";
+        diagnostic.message = syntaxError->message;
+    }
     else
-        report(
-            format,
-            humanReadableName.c_str(),
-            error.location,
-            "TypeError",
-            Luau::toString(error, Luau::TypeErrorToStringOptions{frontend.fileResolver}).c_str()
-        );
+    {
+        diagnostic.type = "TypeError";
+        diagnostic.message = Luau::toString(error, Luau::TypeErrorToStringOptions{frontend.fileResolver});
+    }
+
+    report(format, diagnostic);
+
+    if (diagnostics)
+        diagnostics->push_back(std::move(diagnostic));
 }
 
-void reportWarning(ReportFormat format, const char* name, const Luau::LintWarning& warning)
+void reportWarning(ReportFormat format, const char* name, const Luau::LintWarning& warning, std::vector<Diagnostic>* diagnostics)
 {
     report(format, name, warning.location, Luau::LintWarning::getName(warning.code), warning.text.c_str());
+
+    if (diagnostics)
+        diagnostics->push_back({name, warning.location, Luau::LintWarning::getName(warning.code), warning.text});
 }
 
-bool reportModuleResult(Luau::Frontend& frontend, const Luau::ModuleName& name, ReportFormat format, bool annotate)
+bool reportModuleResult(Luau::Frontend& frontend, const Luau::ModuleName& name, ReportFormat format, bool annotate, std::vector<Diagnostic>* diagnostics)
 {
     std::optional<Luau::CheckResult> cr = frontend.getCheckResult(name, false);
 
@@ -75,14 +97,14 @@ bool reportModuleResult(Luau::Frontend& frontend, const Luau::ModuleName& name,
 
     for (Luau::TypeError& error : cr->errors) {
         // printf("ERROR: %d\n", error.code());
-        reportError(frontend, format, error);
+        reportError(frontend, format, error, diagnostics);
     }
 
     std::string humanReadableName = frontend.fileResolver->getHumanReadableModuleName(name);
     for (auto& error : cr->lintResult.errors)
-        reportWarning(format, humanReadableName.c_str(), error);
+        reportWarning(format, humanReadableName.c_str(), error, diagnostics);
     for (auto& warning : cr->lintResult.warnings)
-        reportWarning(format, humanReadableName.c_str(), warning);
+        reportWarning(format, humanReadableName.c_str(), warning, diagnostics);
 
     if (annotate)
     {
@@ -106,6 +128,36 @@ int assertionHandler(const char* expr, const char* file, int line, const char* f
     return 1;
 }
 
+static uint64_t mix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t h = seed ^ (size * 0x9e3779b97f4a7c15ull);
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        h = (h ^ mix64(word)) * 0x100000001b3ull;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, bytes + i, size - i);
+    h = (h ^ mix64(tail)) * 0x100000001b3ull;
+
+    return mix64(h);
+}
+
 TaskScheduler::TaskScheduler(unsigned threadCount)
     : threadCount(threadCount)
 {
@@ -141,7 +193,7 @@ std::function<void()> TaskScheduler::pop()
         }
     );
 
-    std::function<void()> task = tasks.front();
+    std::function<void()> task = std::move(tasks.front());
     tasks.pop();
     return task;
 }
@@ -163,6 +215,8 @@ unsigned TaskScheduler::getThreadCount()
 
 void TaskScheduler::workerFunction()
 {
+    traceThreadName("TaskScheduler worker");
+
     while (std::function<void()> task = pop())
         task();
 }
@@ -181,32 +235,130 @@ const Luau::Config& ConfigResolver::getConfig(const Luau::ModuleName& name) cons
     return readConfigRec(*path);
 }
 
+bool ConfigResolver::refresh()
+{
+    bool changed = false;
+
+    for (Shard& shard : shards)
+    {
+        for (const auto& [path, entry] : shard.entries)
+        {
+            if (!(statFile(entry->configPath) == entry->stamp))
+            {
+                changed = true;
+                break;
+            }
+        }
+
+        if (changed)
+            break;
+    }
+
+    retired.clear();
+
+    if (!changed)
+        return false;
+
+    // configs are merged into those of subdirectories, so one changed file invalidates everything below it; edits
+    // are rare enough that dropping the whole cache is simpler than tracking that
+    for (Shard& shard : shards)
+    {
+        for (auto& [path, entry] : shard.entries)
+            retired.push_back(std::move(entry));
+
+        shard.entries.clear();
+    }
+
+    std::unique_lock guard(errorsMutex);
+    errors.clear();
+
+    return true;
+}
+
+std::vector<std::pair<std::string, std::string>> ConfigResolver::getErrors() const
+{
+    std::unique_lock guard(errorsMutex);
+    return errors;
+}
+
+ConfigResolver::FileStamp ConfigResolver::statFile(const std::string& path)
+{
+    FileStamp stamp;
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return stamp;
+
+    stamp.exists = true;
+    stamp.device = uint64_t(st.st_dev);
+    stamp.inode = uint64_t(st.st_ino);
+#ifdef __APPLE__
+    const timespec& mtime = st.st_mtimespec;
+#else
+    const timespec& mtime = st.st_mtim;
+#endif
+    stamp.mtime = int64_t(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+    stamp.size = uint64_t(st.st_size);
+    return stamp;
+}
+
+ConfigResolver::Shard& ConfigResolver::shardFor(const std::string& path) const
+{
+    return shards[std::hash<std::string>()(path) % kShardCount];
+}
+
 const Luau::Config& ConfigResolver::readConfigRec(const std::string& path) const
 {
-    auto it = configCache.find(path);
-    if (it != configCache.end())
-        return it->second;
+    Shard& shard = shardFor(path);
+
+    {
+        std::shared_lock guard(shard.mutex);
+
+        auto it = shard.entries.find(path);
+        if (it != shard.entries.end())
+            return it->second->config;
+    }
 
     std::optional<std::string> parent = getParentPath(path);
-    Luau::Config result = parent ? readConfigRec(*parent) : defaultConfig;
 
-    std::string configPath = joinPaths(path, Luau::kConfigName);
+    auto entry = std::make_shared<Entry>();
+    entry->config = parent ? readConfigRec(*parent) : defaultConfig;
+    entry->configPath = joinPaths(path, Luau::kConfigName);
+
+    // stat before reading, so that an edit racing with the read shows up as a change on the next refresh
+    entry->stamp = statFile(entry->configPath);
 
-    if (std::optional<std::string> contents = readFile(configPath))
+    std::optional<std::string> error;
+
+    if (entry->stamp.exists)
     {
-        Luau::ConfigOptions::AliasOptions aliasOpts;
-        aliasOpts.configLocation = configPath;
-        aliasOpts.overwriteAliases = true;
+        TraceSpan span("analysis", "config", entry->configPath);
+
+        if (std::optional<std::string> contents = readFile(entry->configPath))
+        {
+            Luau::ConfigOptions::AliasOptions aliasOpts;
+            aliasOpts.configLocation = entry->configPath;
+            aliasOpts.overwriteAliases = true;
 
-        Luau::ConfigOptions opts;
-        opts.aliasOptions = std::move(aliasOpts);
+            Luau::ConfigOptions opts;
+            opts.aliasOptions = std::move(aliasOpts);
 
-        std::optional<std::string> error = Luau::parseConfig(*contents, result, opts);
-        if (error)
-            configErrors.push_back({configPath, *error});
+            error = Luau::parseConfig(*contents, entry->config, opts);
+        }
     }
 
-    return configCache[path] = result;
+    std::unique_lock guard(shard.mutex);
+
+    // another worker may have read the same directory in the meantime, in which case its entry and errors are kept
+    auto [it, inserted] = shard.entries.try_emplace(path, std::move(entry));
+
+    if (inserted && error)
+    {
+        std::unique_lock errorsGuard(errorsMutex);
+        errors.push_back({it->second->configPath, *error});
+    }
+
+    return it->second->config;
 }
 
 struct FileResolver::AnalysisRequireContext : RequireResolver::RequireContext
@@ -252,40 +404,75 @@ struct FileResolver::AnalysisErrorHandler : RequireResolver::ErrorHandler
 
 std::optional<Luau::SourceCode> FileResolver::readSource(const Luau::ModuleName& name)
 {
-    Luau::SourceCode::Type sourceType;
-    std::optional<std::string> source = std::nullopt;
+    std::optional<std::string_view> added;
 
-    // If the module name is "-", then read source from stdin
-    if (name == "-")
     {
-        source = readStdin();
-        sourceType = Luau::SourceCode::Script;
+        std::unique_lock guard(sourceHashMutex);
+
+        if (auto it = addedSources.find(name); it != addedSources.end())
+            added = it->second;
     }
-    else
+
+    // sources added by the caller are used as is; files are read once, into the buffer SourceCode copies from
+    std::optional<SourceFile> file;
+    if (!added)
+    {
+        file = SourceFile::open(name);
+        if (!file)
+            return std::nullopt;
+    }
+
+    std::string_view source = added ? *added : file->view();
+
+    // If the module name is "-", then the source was read from stdin
+    Luau::SourceCode::Type sourceType = !added && name == "-" ? Luau::SourceCode::Script : Luau::SourceCode::Module;
+
     {
-        source = readFile(name);
-        sourceType = Luau::SourceCode::Module;
+        std::unique_lock guard(sourceHashMutex);
+        sourceHashes[name] = hashBytes(source.data(), source.size());
     }
 
-    if (!source)
+    if (sourceObserver)
+        sourceObserver(name, source);
+
+    return Luau::SourceCode{std::string(source), sourceType};
+}
+
+std::optional<uint64_t> FileResolver::getSourceHash(const Luau::ModuleName& name) const
+{
+    std::unique_lock guard(sourceHashMutex);
+
+    auto it = sourceHashes.find(name);
+    if (it == sourceHashes.end())
         return std::nullopt;
 
-    return Luau::SourceCode{*source, sourceType};
+    return it->second;
+}
+
+void FileResolver::addSource(const Luau::ModuleName& name, std::string_view source)
+{
+    std::unique_lock guard(sourceHashMutex);
+    addedSources[name] = source;
+}
+
+void FileResolver::setSourceObserver(SourceObserver observer)
+{
+    sourceObserver = std::move(observer);
 }
 
 std::optional<Luau::ModuleInfo> FileResolver::resolveModule(const Luau::ModuleInfo* context, Luau::AstExpr* node)
 {
     if (Luau::AstExprConstantString* expr = node->as<Luau::AstExprConstantString>())
     {
-        std::string path{expr->value.data, expr->value.size};
-
         // here, we'll need to handle standard library modules,
         // building path to where they are in the bundle. (platform specific)
-        if (path.find('/') == std::string::npos) {
-            path = "./" + path;
-        }
+        std::string path = RequireCache::normalizeRequire({expr->value.data, expr->value.size});
         // std::cout << "RESOLVING MODULE: " << path << std::endl;
 
+        RequireCache& requireCache = sharedRequireCache();
+        if (std::optional<RequireCache::Resolution> cached = requireCache.find(context->name, path))
+            return {{cached->path}};
+
         AnalysisRequireContext requireContext{context->name};
         AnalysisCacheManager cacheManager;
         AnalysisErrorHandler errorHandler;
@@ -294,12 +481,50 @@ std::optional<Luau::ModuleInfo> FileResolver::resolveModule(const Luau::ModuleIn
         RequireResolver::ResolvedRequire resolvedRequire = resolver.resolveRequire();
 
         if (resolvedRequire.status == RequireResolver::ModuleStatus::FileRead)
+        {
+            // read again for the cache, so that the stamp is taken before the source it describes
+            if (std::optional<RequireCache::Resolution> module = RequireCache::readModule(resolvedRequire.identifier, resolvedRequire.absolutePath))
+                requireCache.add(context->name, path, std::move(*module));
+
             return {{resolvedRequire.identifier}};
+        }
+
+        std::unique_lock guard(unresolvedMutex);
+
+        std::vector<std::string>& unresolved = unresolvedRequires[context->name];
+        if (std::find(unresolved.begin(), unresolved.end(), path) == unresolved.end())
+            unresolved.push_back(std::move(path));
     }
 
     return std::nullopt;
 }
 
+std::vector<std::string> FileResolver::getUnresolvedRequires(const Luau::ModuleName& name) const
+{
+    std::unique_lock guard(unresolvedMutex);
+
+    auto it = unresolvedRequires.find(name);
+    if (it == unresolvedRequires.end())
+        return {};
+
+    return it->second;
+}
+
+std::optional<Luau::ModuleName> FileResolver::resolveRequire(const Luau::ModuleName& context, const std::string& require)
+{
+    AnalysisRequireContext requireContext{context};
+    AnalysisCacheManager cacheManager;
+    AnalysisErrorHandler errorHandler;
+
+    RequireResolver resolver(require, requireContext, cacheManager, errorHandler);
+    RequireResolver::ResolvedRequire resolvedRequire = resolver.resolveRequire();
+
+    if (resolvedRequire.status != RequireResolver::ModuleStatus::FileRead)
+        return std::nullopt;
+
+    return resolvedRequire.identifier;
+}
+
 std::string FileResolver::getHumanReadableModuleName(const Luau::ModuleName& name) const
 {
     if (name == "-")
@@ -341,10 +566,16 @@ RuntimeCacheManager::RuntimeCacheManager(lua_State* L)
 
 bool RuntimeCacheManager::isCached(const std::string& path)
 {
-    luaL_findtable(L, LUA_REGISTRYINDEX, "_MODULES", 1);
-    lua_getfield(L, -1, path.c_str());
-    bool cached = !lua_isnil(L, -1);
-    lua_pop(L, 2);
+    // called for every candidate path; lua_require creates the table once something is actually loaded
+    lua_getfield(L, LUA_REGISTRYINDEX, "_MODULES");
+    bool cached = false;
+    if (lua_istable(L, -1))
+    {
+        lua_getfield(L, -1, path.c_str());
+        cached = !lua_isnil(L, -1);
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
 
     if (cached)
         cacheKey = path;
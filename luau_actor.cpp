@@ -0,0 +1,584 @@
+#include "luau_actor.hpp"
+#include "luau_event_loop.hpp"
+#include "luau_runtime.hpp"
+#include "luau_source.hpp"
+#include "luau_state_pool.hpp"
+#include "luau_trace.hpp"
+#include "luau_work_stealing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "lualib.h"
+
+namespace LuauUtils {
+
+namespace {
+
+enum class Tag : uint8_t
+{
+    Nil,
+    False,
+    True,
+    Number,
+    String,
+    Buffer,
+    Table,
+    TableEnd,
+};
+
+// tables nested deeper than this are most likely cyclic
+constexpr int kMaxDepth = 128;
+
+const char* const kActorType = "Actor";
+
+std::mutex actorStatesMutex;
+std::unique_ptr<StatePool> actorStatePool;
+
+// Actors block on their channels while holding a state, so the pool never makes anyone wait for one
+StatePool& actorStates()
+{
+    std::unique_lock guard(actorStatesMutex);
+
+    if (!actorStatePool)
+        actorStatePool = std::make_unique<StatePool>(std::numeric_limits<size_t>::max());
+
+    return *actorStatePool;
+}
+
+void appendBytes(std::string& out, const void* data, size_t size)
+{
+    out.append(static_cast<const char*>(data), size);
+}
+
+void appendSized(std::string& out, Tag tag, const void* data, size_t size)
+{
+    uint64_t length = size;
+    out.push_back(char(tag));
+    appendBytes(out, &length, sizeof(length));
+    appendBytes(out, data, size);
+}
+
+template<typename T>
+T readRaw(std::string_view& data)
+{
+    T value;
+    memcpy(&value, data.data(), sizeof(T));
+    data.remove_prefix(sizeof(T));
+    return value;
+}
+
+bool encode(lua_State* L, int idx, std::string& out, std::string& error, int depth)
+{
+    switch (lua_type(L, idx))
+    {
+    case LUA_TNIL:
+        out.push_back(char(Tag::Nil));
+        return true;
+
+    case LUA_TBOOLEAN:
+        out.push_back(char(lua_toboolean(L, idx) ? Tag::True : Tag::False));
+        return true;
+
+    case LUA_TNUMBER:
+    {
+        double number = lua_tonumber(L, idx);
+        out.push_back(char(Tag::Number));
+        appendBytes(out, &number, sizeof(number));
+        return true;
+    }
+
+    case LUA_TSTRING:
+    {
+        size_t length = 0;
+        const char* str = lua_tolstring(L, idx, &length);
+        appendSized(out, Tag::String, str, length);
+        return true;
+    }
+
+    case LUA_TBUFFER:
+    {
+        size_t length = 0;
+        void* data = lua_tobuffer(L, idx, &length);
+        appendSized(out, Tag::Buffer, data, length);
+        return true;
+    }
+
+    case LUA_TTABLE:
+    {
+        if (depth >= kMaxDepth)
+        {
+            error = "tables nested too deeply to send (cyclic tables can't be sent)";
+            return false;
+        }
+
+        lua_checkstack(L, 2);
+        out.push_back(char(Tag::Table));
+
+        lua_pushnil(L);
+        while (lua_next(L, idx))
+        {
+            if (!encode(L, lua_gettop(L) - 1, out, error, depth + 1) || !encode(L, lua_gettop(L), out, error, depth + 1))
+            {
+                lua_pop(L, 2);
+                return false;
+            }
+
+            lua_pop(L, 1);
+        }
+
+        out.push_back(char(Tag::TableEnd));
+        return true;
+    }
+
+    default:
+        error = std::string("can't send a value of type ") + lua_typename(L, lua_type(L, idx));
+        return false;
+    }
+}
+
+}
+
+bool encodeValue(lua_State* L, int idx, std::string& out, std::string& error)
+{
+    return encode(L, lua_absindex(L, idx), out, error, 0);
+}
+
+void decodeValue(lua_State* L, std::string_view& data)
+{
+    lua_checkstack(L, 3);
+
+    Tag tag = Tag(data[0]);
+    data.remove_prefix(1);
+
+    switch (tag)
+    {
+    case Tag::Nil:
+        lua_pushnil(L);
+        break;
+
+    case Tag::False:
+    case Tag::True:
+        lua_pushboolean(L, tag == Tag::True);
+        break;
+
+    case Tag::Number:
+        lua_pushnumber(L, readRaw<double>(data));
+        break;
+
+    case Tag::String:
+    {
+        size_t length = size_t(readRaw<uint64_t>(data));
+        lua_pushlstring(L, data.data(), length);
+        data.remove_prefix(length);
+        break;
+    }
+
+    case Tag::Buffer:
+    {
+        size_t length = size_t(readRaw<uint64_t>(data));
+        memcpy(lua_newbuffer(L, length), data.data(), length);
+        data.remove_prefix(length);
+        break;
+    }
+
+    case Tag::Table:
+        lua_newtable(L);
+
+        while (Tag(data[0]) != Tag::TableEnd)
+        {
+            decodeValue(L, data);
+            decodeValue(L, data);
+            lua_rawset(L, -3);
+        }
+
+        data.remove_prefix(1);
+        break;
+
+    case Tag::TableEnd:
+        break;
+    }
+}
+
+Actor::Actor(std::string path, std::string source)
+    : path(std::move(path))
+    , source(std::move(source))
+{
+    thread = std::thread(
+        [this]
+        {
+            run();
+        }
+    );
+}
+
+Actor::~Actor()
+{
+    // an actor blocked on either channel gives up once they close
+    inbox.close();
+    outbox.close();
+    join();
+}
+
+void Actor::join()
+{
+    if (thread.joinable())
+        thread.join();
+}
+
+void Actor::run()
+{
+    if (traceEnabled())
+        traceThreadName("actor " + path);
+
+    StatePool& pool = actorStates();
+
+    if (lua_State* L = pool.acquire())
+    {
+        getStateData(L)->actor = this;
+
+        int status = loadScript(L, source, /* sandboxed= */ true, "@" + path);
+        if (status == LUA_OK)
+            status = resumeScript(L);
+
+        getStateData(L)->actor = nullptr;
+        pool.release(L, status);
+    }
+
+    inbox.close();
+    outbox.close();
+}
+
+namespace {
+
+Actor* checkActor(lua_State* L, int idx)
+{
+    return static_cast<std::unique_ptr<Actor>*>(luaL_checkudata(L, idx, kActorType))->get();
+}
+
+// the actor the calling state runs, for actor.send and actor.receive
+Actor* currentActor(lua_State* L, const char* function)
+{
+    Actor* actor = getStateData(L)->actor;
+    if (!actor)
+        luaL_error(L, "%s can only be called from inside an actor", function);
+
+    return actor;
+}
+
+std::string encodeArgument(lua_State* L, int idx)
+{
+    std::string message;
+    std::string error;
+
+    if (!encodeValue(L, idx, message, error))
+        luaL_error(L, "%s", error.c_str());
+
+    return message;
+}
+
+int pushReceived(lua_State* L, BoundedChannel<std::string>& channel)
+{
+    std::string message;
+
+    if (!channel.receive(message))
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    std::string_view data = message;
+    decodeValue(L, data);
+    return 1;
+}
+
+std::string readScript(lua_State* L, const std::string& path)
+{
+    std::optional<SourceFile> file = SourceFile::open(path);
+    if (!file)
+        luaL_error(L, "could not open %s", path.c_str());
+
+    return std::string(file->view());
+}
+
+int actor_spawn(lua_State* L)
+{
+    std::string path = luaL_checkstring(L, 1);
+    std::string source = readScript(L, path);
+
+    void* storage = lua_newuserdatadtor(
+        L,
+        sizeof(std::unique_ptr<Actor>),
+        [](void* handle)
+        {
+            static_cast<std::unique_ptr<Actor>*>(handle)->~unique_ptr();
+        }
+    );
+
+    new (storage) std::unique_ptr<Actor>(std::make_unique<Actor>(std::move(path), std::move(source)));
+
+    luaL_getmetatable(L, kActorType);
+    lua_setmetatable(L, -2);
+    return 1;
+}
+
+int actor_handleSend(lua_State* L)
+{
+    Actor* actor = checkActor(L, 1);
+
+    if (!actor->inbox.send(encodeArgument(L, 2)))
+        luaL_error(L, "the actor has stopped");
+
+    return 0;
+}
+
+int actor_handleReceive(lua_State* L)
+{
+    return pushReceived(L, checkActor(L, 1)->outbox);
+}
+
+int actor_handleClose(lua_State* L)
+{
+    checkActor(L, 1)->inbox.close();
+    return 0;
+}
+
+int actor_handleJoin(lua_State* L)
+{
+    checkActor(L, 1)->join();
+    return 0;
+}
+
+int actor_send(lua_State* L)
+{
+    Actor* actor = currentActor(L, "actor.send");
+
+    if (!actor->outbox.send(encodeArgument(L, 1)))
+        luaL_error(L, "the actor was closed");
+
+    return 0;
+}
+
+int actor_receive(lua_State* L)
+{
+    return pushReceived(L, currentActor(L, "actor.receive")->inbox);
+}
+
+struct MapJob
+{
+    std::string source;
+    std::string chunkname;
+    std::vector<std::string> inputs;
+    std::vector<std::string> results;
+
+    // workers claim items in order, so no item is waited on while another worker is idle
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+
+    std::mutex errorMutex;
+    std::string error;
+
+    void fail(const std::string& message)
+    {
+        std::unique_lock guard(errorMutex);
+
+        if (!failed.exchange(true))
+            error = message;
+    }
+};
+
+// Applies the function the module returns to items of job until none are left
+void runMapWorker(MapJob& job)
+{
+    traceThreadName("actor.map worker");
+
+    StatePool& pool = actorStates();
+
+    lua_State* L = pool.acquire();
+    if (!L)
+    {
+        job.fail("could not create a state for actor.map");
+        return;
+    }
+
+    int status = loadScript(L, job.source, /* sandboxed= */ true, job.chunkname);
+    if (status != LUA_OK)
+    {
+        job.fail("could not load " + job.chunkname.substr(1));
+        pool.release(L, status);
+        return;
+    }
+
+    lua_State* T = lua_tothread(L, -1);
+
+    // callbacks the module or the mapped function scheduled with task.delay and friends run here, before the state
+    // goes back to the pool, instead of in whichever script gets the state next
+    auto runLoop = [L, T](int status)
+    {
+        if (EventLoop* loop = getStateData(L)->loop; loop && loop->hasPending())
+            return loop->run(T, status);
+
+        return status;
+    };
+
+    status = runLoop(lua_resume(T, nullptr, 0));
+
+    if (status != LUA_OK)
+    {
+        const char* str = lua_tostring(T, -1);
+        job.fail(str ? str : "module did not finish");
+    }
+    else if (!lua_isfunction(T, -1))
+    {
+        job.fail("actor.map module must return a function");
+    }
+    else
+    {
+        int function = lua_gettop(T);
+
+        for (size_t i = job.next.fetch_add(1); i < job.inputs.size() && !job.failed.load(); i = job.next.fetch_add(1))
+        {
+            lua_pushvalue(T, function);
+
+            std::string_view data = job.inputs[i];
+            decodeValue(T, data);
+
+            int callStatus = runLoop(lua_pcall(T, 1, 1, 0));
+
+            if (callStatus != LUA_OK)
+            {
+                const char* str = lua_tostring(T, -1);
+                job.fail(str ? str : "unknown error in actor.map");
+                break;
+            }
+
+            std::string error;
+            if (!encodeValue(T, -1, job.results[i], error))
+            {
+                job.fail(error);
+                break;
+            }
+
+            lua_pop(T, 1);
+        }
+    }
+
+    // errors raised by the mapped function don't leave the state in doubt, unlike one of its chunk
+    lua_pop(L, 1);
+    pool.release(L, status);
+}
+
+int actor_map(lua_State* L)
+{
+    std::string path = luaL_checkstring(L, 1);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int workers = luaL_optinteger(L, 3, 0);
+
+    MapJob job;
+    job.source = readScript(L, path);
+    job.chunkname = "@" + path;
+
+    size_t count = lua_objlen(L, 2);
+    job.inputs.resize(count);
+    job.results.resize(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        lua_rawgeti(L, 2, int(i + 1));
+        job.inputs[i] = encodeArgument(L, -1);
+        lua_pop(L, 1);
+    }
+
+    size_t threadCount = workers > 0 ? size_t(workers) : WorkStealingScheduler::getThreadCount();
+    threadCount = std::min(threadCount, count);
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back(
+            [&job]
+            {
+                runMapWorker(job);
+            }
+        );
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    if (job.failed.load())
+        luaL_error(L, "%s", job.error.c_str());
+
+    lua_createtable(L, int(count), 0);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        std::string_view data = job.results[i];
+        decodeValue(L, data);
+        lua_rawseti(L, -2, int(i + 1));
+    }
+
+    return 1;
+}
+
+}
+
+const char* const kActorDefinitions = R"(
+declare class Actor
+    function send(self, value: any): ()
+    function receive(self): any
+    function close(self): ()
+    function join(self): ()
+end
+
+declare actor: {
+    spawn: (path: string) -> Actor,
+    map: (path: string, items: {any}, workers: number?) -> {any},
+    send: (value: any) -> (),
+    receive: () -> any,
+}
+)";
+
+void openActorLibrary(lua_State* L)
+{
+    static const luaL_Reg handleFuncs[] = {
+        {"send", actor_handleSend},
+        {"receive", actor_handleReceive},
+        {"close", actor_handleClose},
+        {"join", actor_handleJoin},
+        {NULL, NULL},
+    };
+
+    static const luaL_Reg actorFuncs[] = {
+        {"spawn", actor_spawn},
+        {"map", actor_map},
+        {"send", actor_send},
+        {"receive", actor_receive},
+        {NULL, NULL},
+    };
+
+    luaL_newmetatable(L, kActorType);
+    lua_newtable(L);
+    luaL_register(L, NULL, handleFuncs);
+    lua_setfield(L, -2, "__index");
+    lua_pushstring(L, kActorType);
+    lua_setfield(L, -2, "__type");
+    lua_pop(L, 1);
+
+    luaL_register(L, "actor", actorFuncs);
+    lua_pop(L, 1);
+}
+
+void closeActorStates()
+{
+    std::unique_lock guard(actorStatesMutex);
+    actorStatePool.reset();
+}
+
+}
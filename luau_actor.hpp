@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "lua.h"
+
+#include "luau_channel.hpp"
+
+namespace LuauUtils
+{
+    // Values that can cross between states: nil, booleans, numbers, strings, buffers and tables of those. A value is
+    // encoded into one string, which is what channels carry, so handing a message over moves a pointer.
+    bool encodeValue(lua_State* L, int idx, std::string& out, std::string& error);
+    // Pushes the value encoded at the start of data and advances data past it
+    void decodeValue(lua_State* L, std::string_view& data);
+
+    // A script running on its own thread in a state of its own, taken from a pool of sandboxed states. It talks to
+    // the state that spawned it over two bounded channels of encoded values.
+    class Actor
+    {
+    public:
+        static constexpr size_t kChannelCapacity = 64;
+
+        Actor(std::string path, std::string source);
+        // closes both channels and waits for the script to end
+        ~Actor();
+
+        Actor(const Actor&) = delete;
+        Actor& operator=(const Actor&) = delete;
+
+        void join();
+
+        // from the spawning state to the actor
+        BoundedChannel<std::string> inbox{kChannelCapacity};
+        // from the actor back; both are closed when its script ends
+        BoundedChannel<std::string> outbox{kChannelCapacity};
+
+    private:
+        void run();
+
+        std::string path;
+        std::string source;
+        std::thread thread;
+    };
+
+    // Registers the actor library: actor.spawn and actor.map everywhere, actor.send and actor.receive inside actors
+    void openActorLibrary(lua_State* L);
+
+    // Type definitions of the actor library, for analysis
+    extern const char* const kActorDefinitions;
+
+    // Closes the pooled states actors and parallel maps ran on; no actor may be running
+    void closeActorStates();
+}
@@ -0,0 +1,367 @@
+#include "luau_allocator.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+
+namespace LuauUtils {
+
+namespace {
+
+// multiples of 16 so that every block keeps malloc's alignment; the largest two fit the VM's GC pages
+constexpr size_t kSizeClasses[] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 8192, 16384, 32768,
+};
+constexpr int kClassCount = int(std::size(kSizeClasses));
+
+static_assert(kSizeClasses[kClassCount - 1] == StateAllocator::kMaxPooledSize);
+
+// classes up to here are carved out of slabs; bigger blocks are malloc'd one at a time so they can be given back
+constexpr size_t kMaxCarvedSize = 4096;
+constexpr size_t kSlabSize = 256 * 1024;
+constexpr size_t kArenaSlabSize = 64 * 1024;
+
+// a thread keeps at most this much free memory per class before handing blocks to the depot or back to malloc
+constexpr size_t kMaxCachedBytes = 1 << 20;
+
+int sizeClassOf(size_t size)
+{
+    if (size == 0 || size > StateAllocator::kMaxPooledSize)
+        return -1;
+
+    return int(std::lower_bound(std::begin(kSizeClasses), std::end(kSizeClasses), size) - std::begin(kSizeClasses));
+}
+
+struct FreeNode
+{
+    FreeNode* next;
+};
+
+struct FreeList
+{
+    FreeNode* head = nullptr;
+    FreeNode* tail = nullptr;
+    size_t count = 0;
+
+    void push(void* ptr)
+    {
+        FreeNode* node = static_cast<FreeNode*>(ptr);
+        node->next = head;
+        head = node;
+        if (!tail)
+            tail = node;
+        count++;
+    }
+
+    void* pop()
+    {
+        FreeNode* node = head;
+        head = node->next;
+        if (!head)
+            tail = nullptr;
+        count--;
+        return node;
+    }
+
+    // moves the whole of other to the front of this list in constant time, so the depot lock is held only briefly
+    void splice(FreeList& other)
+    {
+        if (!other.head)
+            return;
+
+        other.tail->next = head;
+        if (!tail)
+            tail = other.tail;
+        head = other.head;
+        count += other.count;
+
+        other = FreeList();
+    }
+
+    // moves up to n blocks from the front of other to this list, which must be empty
+    void take(FreeList& other, size_t n)
+    {
+        if (n >= other.count)
+        {
+            splice(other);
+            return;
+        }
+
+        FreeNode* last = other.head;
+        for (size_t i = 1; i < n; i++)
+            last = last->next;
+
+        head = other.head;
+        tail = last;
+        count = n;
+
+        other.head = last->next;
+        other.count -= n;
+        last->next = nullptr;
+    }
+};
+
+// Blocks that threads gave up, either because their cache was full or because they exited
+struct Depot
+{
+    std::mutex mtx;
+    FreeList lists[kClassCount];
+};
+
+// never destroyed: thread caches flush into it when their threads exit, which may be after static destructors ran
+Depot& depot()
+{
+    static Depot* instance = new Depot();
+    return *instance;
+}
+
+struct ThreadCache
+{
+    FreeList lists[kClassCount];
+
+    ~ThreadCache()
+    {
+        Depot& shared = depot();
+        std::unique_lock guard(shared.mtx);
+
+        for (int i = 0; i < kClassCount; i++)
+            shared.lists[i].splice(lists[i]);
+    }
+
+    void* allocate(int sizeClass)
+    {
+        FreeList& list = lists[sizeClass];
+
+        if (!list.head)
+            refill(sizeClass, list);
+
+        return list.head ? list.pop() : nullptr;
+    }
+
+    void deallocate(void* ptr, int sizeClass)
+    {
+        FreeList& list = lists[sizeClass];
+        list.push(ptr);
+
+        size_t size = kSizeClasses[sizeClass];
+        if (list.count * size <= kMaxCachedBytes)
+            return;
+
+        // keep half, so that a state alternating between allocating and freeing doesn't bounce blocks around
+        size_t excess = list.count / 2;
+
+        if (size <= kMaxCarvedSize)
+        {
+            FreeList released;
+            released.take(list, excess);
+
+            Depot& shared = depot();
+            std::unique_lock guard(shared.mtx);
+            shared.lists[sizeClass].splice(released);
+        }
+        else
+        {
+            for (size_t i = 0; i < excess; i++)
+                free(list.pop());
+        }
+    }
+
+    static void refill(int sizeClass, FreeList& list)
+    {
+        {
+            Depot& shared = depot();
+            std::unique_lock guard(shared.mtx);
+
+            // a bounded batch: the rest stays for other threads, and the walk under the lock stays short
+            if (shared.lists[sizeClass].head)
+            {
+                list.take(shared.lists[sizeClass], std::max<size_t>(kMaxCachedBytes / kSizeClasses[sizeClass] / 2, 1));
+                return;
+            }
+        }
+
+        size_t size = kSizeClasses[sizeClass];
+
+        if (size > kMaxCarvedSize)
+        {
+            if (void* block = malloc(size))
+                list.push(block);
+            return;
+        }
+
+        // slabs are never returned to malloc; their blocks circulate between threads through the depot
+        char* slab = static_cast<char*>(malloc(kSlabSize));
+        if (!slab)
+            return;
+
+        for (size_t offset = 0; offset + size <= kSlabSize; offset += size)
+            list.push(slab + offset);
+    }
+};
+
+thread_local ThreadCache threadCache;
+
+}
+
+StateAllocator::StateAllocator(AllocatorMode mode, size_t limit)
+    : mode(mode)
+    , limit(limit)
+{
+    if (mode == AllocatorMode::Arena)
+        arenaFreeLists.resize(kClassCount, nullptr);
+}
+
+StateAllocator::~StateAllocator()
+{
+    for (void* slab : slabs)
+        free(slab);
+}
+
+void* StateAllocator::alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    StateAllocator* self = static_cast<StateAllocator*>(ud);
+    MemoryStats& stats = self->stats;
+
+    // the VM always passes the exact size of the block it is resizing or freeing
+    size_t oldSize = ptr ? osize : 0;
+
+    if (self->limit && nsize > oldSize && stats.liveBytes - oldSize + nsize > self->limit)
+    {
+        stats.limitFailures++;
+        return nullptr;
+    }
+
+    void* result = self->reallocate(ptr, oldSize, nsize);
+    if (nsize > 0 && !result)
+        return nullptr;
+
+    stats.liveBytes = stats.liveBytes - oldSize + nsize;
+    stats.peakBytes = std::max(stats.peakBytes, stats.liveBytes);
+
+    if (nsize == 0)
+        stats.frees += ptr != nullptr;
+    else if (ptr)
+        stats.reallocations++;
+    else
+        stats.allocations++;
+
+    return result;
+}
+
+StateAllocator* StateAllocator::of(lua_State* L)
+{
+    void* ud = nullptr;
+    lua_Alloc f = lua_getallocf(L, &ud);
+
+    return f == alloc ? static_cast<StateAllocator*>(ud) : nullptr;
+}
+
+const MemoryStats& StateAllocator::getStats() const
+{
+    return stats;
+}
+
+size_t StateAllocator::getLimit() const
+{
+    return limit;
+}
+
+AllocatorMode StateAllocator::getMode() const
+{
+    return mode;
+}
+
+void* StateAllocator::allocate(size_t size)
+{
+    int sizeClass = mode == AllocatorMode::System ? -1 : sizeClassOf(size);
+
+    if (sizeClass < 0)
+        return malloc(size);
+
+    if (mode == AllocatorMode::Arena)
+        return arenaAllocate(sizeClass);
+
+    return threadCache.allocate(sizeClass);
+}
+
+void StateAllocator::deallocate(void* ptr, size_t size)
+{
+    int sizeClass = mode == AllocatorMode::System ? -1 : sizeClassOf(size);
+
+    if (sizeClass < 0)
+        free(ptr);
+    else if (mode == AllocatorMode::Arena)
+        arenaDeallocate(ptr, sizeClass);
+    else
+        threadCache.deallocate(ptr, sizeClass);
+}
+
+void* StateAllocator::reallocate(void* ptr, size_t osize, size_t nsize)
+{
+    if (nsize == 0)
+    {
+        if (ptr)
+            deallocate(ptr, osize);
+        return nullptr;
+    }
+
+    if (!ptr)
+        return allocate(nsize);
+
+    int oldClass = mode == AllocatorMode::System ? -1 : sizeClassOf(osize);
+    int newClass = mode == AllocatorMode::System ? -1 : sizeClassOf(nsize);
+
+    // the block already has room for the new size
+    if (oldClass >= 0 && oldClass == newClass)
+        return ptr;
+
+    if (oldClass < 0 && newClass < 0)
+        return realloc(ptr, nsize);
+
+    void* result = allocate(nsize);
+    if (!result)
+        return nullptr;
+
+    memcpy(result, ptr, std::min(osize, nsize));
+    deallocate(ptr, osize);
+    return result;
+}
+
+void* StateAllocator::arenaAllocate(int sizeClass)
+{
+    FreeList list{static_cast<FreeNode*>(arenaFreeLists[sizeClass]), 0};
+
+    if (list.head)
+    {
+        void* block = list.pop();
+        arenaFreeLists[sizeClass] = list.head;
+        return block;
+    }
+
+    size_t size = kSizeClasses[sizeClass];
+
+    if (slabs.empty() || slabOffset + size > kArenaSlabSize)
+    {
+        void* slab = malloc(kArenaSlabSize);
+        if (!slab)
+            return nullptr;
+
+        slabs.push_back(slab);
+        slabOffset = 0;
+    }
+
+    void* block = static_cast<char*>(slabs.back()) + slabOffset;
+    slabOffset += size;
+    return block;
+}
+
+void StateAllocator::arenaDeallocate(void* ptr, int sizeClass)
+{
+    FreeList list{static_cast<FreeNode*>(arenaFreeLists[sizeClass]), 0};
+    list.push(ptr);
+    arenaFreeLists[sizeClass] = list.head;
+}
+
+}
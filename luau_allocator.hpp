@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lua.h"
+
+namespace LuauUtils
+{
+    enum class AllocatorMode
+    {
+        // luaL_newstate and the C runtime's realloc
+        System,
+        // size-class free lists cached per thread, shared by every pooled state
+        Pool,
+        // per-state slabs released all at once when the state is closed, for short-lived states
+        Arena,
+    };
+
+    struct MemoryStats
+    {
+        size_t liveBytes = 0;
+        size_t peakBytes = 0;
+        uint64_t allocations = 0;
+        uint64_t reallocations = 0;
+        uint64_t frees = 0;
+        // allocations refused because they would have gone over the limit
+        uint64_t limitFailures = 0;
+    };
+
+    // lua_Alloc for a single state, with memory accounting and an optional hard limit.
+    // Going over the limit makes the allocation fail, which the VM raises as a regular "not enough memory" error.
+    // Small blocks and the VM's GC pages come from size classes up to kMaxPooledSize, larger ones from malloc.
+    class StateAllocator
+    {
+    public:
+        static constexpr size_t kMaxPooledSize = 32 * 1024;
+
+        // limit is in bytes of live memory, 0 for none
+        StateAllocator(AllocatorMode mode, size_t limit);
+        ~StateAllocator();
+
+        StateAllocator(const StateAllocator&) = delete;
+        StateAllocator& operator=(const StateAllocator&) = delete;
+
+        static void* alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+        // The allocator of a state created with alloc, or nullptr
+        static StateAllocator* of(lua_State* L);
+
+        const MemoryStats& getStats() const;
+        size_t getLimit() const;
+        AllocatorMode getMode() const;
+
+    private:
+        void* allocate(size_t size);
+        void deallocate(void* ptr, size_t size);
+        void* reallocate(void* ptr, size_t osize, size_t nsize);
+
+        void* arenaAllocate(int sizeClass);
+        void arenaDeallocate(void* ptr, int sizeClass);
+
+        AllocatorMode mode;
+        size_t limit = 0;
+        MemoryStats stats;
+
+        // arena mode only: slabs blocks are bump-allocated from, and per size class lists of blocks freed since
+        std::vector<void*> slabs;
+        size_t slabOffset = 0;
+        std::vector<void*> arenaFreeLists;
+    };
+}
@@ -0,0 +1,347 @@
+#include "luau_analysis_cache.hpp"
+#include "luau_source.hpp"
+#include "Luau/FileUtils.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace LuauUtils {
+
+namespace {
+
+constexpr char kCacheMagic[4] = {'L', 'A', 'C', 'C'};
+constexpr uint32_t kCacheFormatVersion = 2;
+
+struct Writer
+{
+    std::string data;
+
+    void u32(uint32_t value)
+    {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void u64(uint64_t value)
+    {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void str(const std::string& value)
+    {
+        u32(uint32_t(value.size()));
+        data.append(value);
+    }
+};
+
+struct Reader
+{
+    const std::string& data;
+    size_t offset = 0;
+    bool ok = true;
+
+    bool read(void* out, size_t size)
+    {
+        if (!ok || data.size() - offset < size)
+            return ok = false;
+
+        memcpy(out, data.data() + offset, size);
+        offset += size;
+        return true;
+    }
+
+    uint32_t u32()
+    {
+        uint32_t value = 0;
+        read(&value, sizeof(value));
+        return value;
+    }
+
+    uint64_t u64()
+    {
+        uint64_t value = 0;
+        read(&value, sizeof(value));
+        return value;
+    }
+
+    std::string str()
+    {
+        uint32_t size = u32();
+        if (!ok || data.size() - offset < size)
+        {
+            ok = false;
+            return {};
+        }
+
+        std::string value = data.substr(offset, size);
+        offset += size;
+        return value;
+    }
+};
+
+}
+
+AnalysisCache::AnalysisCache(std::string path, std::string buildId, Luau::Mode mode)
+    : path(std::move(path))
+    , buildId(std::move(buildId))
+    , mode(mode)
+{
+}
+
+bool AnalysisCache::load()
+{
+    std::optional<std::string> contents = readFile(path);
+    if (!contents)
+        return false;
+
+    Reader reader{*contents};
+
+    char magic[4];
+    if (!reader.read(magic, sizeof(magic)) || memcmp(magic, kCacheMagic, sizeof(magic)) != 0)
+        return false;
+
+    if (reader.u32() != kCacheFormatVersion || reader.str() != buildId || reader.u32() != uint32_t(mode))
+        return false;
+
+    std::unordered_map<Luau::ModuleName, Entry> loaded;
+
+    uint32_t moduleCount = reader.u32();
+    for (uint32_t i = 0; i < moduleCount && reader.ok; i++)
+    {
+        Luau::ModuleName name = reader.str();
+
+        Entry entry;
+        entry.sourceHash = reader.u64();
+        entry.configHash = reader.u64();
+        entry.success = reader.u32() != 0;
+
+        uint32_t dependencyCount = reader.u32();
+        for (uint32_t j = 0; j < dependencyCount && reader.ok; j++)
+            entry.dependencies.push_back(reader.str());
+
+        uint32_t unresolvedCount = reader.u32();
+        for (uint32_t j = 0; j < unresolvedCount && reader.ok; j++)
+            entry.unresolvedRequires.push_back(reader.str());
+
+        uint32_t diagnosticCount = reader.u32();
+        for (uint32_t j = 0; j < diagnosticCount && reader.ok; j++)
+        {
+            Diagnostic diagnostic;
+            diagnostic.name = reader.str();
+            diagnostic.location.begin.line = reader.u32();
+            diagnostic.location.begin.column = reader.u32();
+            diagnostic.location.end.line = reader.u32();
+            diagnostic.location.end.column = reader.u32();
+            diagnostic.type = reader.str();
+            diagnostic.message = reader.str();
+            entry.diagnostics.push_back(std::move(diagnostic));
+        }
+
+        loaded[std::move(name)] = std::move(entry);
+    }
+
+    if (!reader.ok)
+        return false;
+
+    entries = std::move(loaded);
+    return true;
+}
+
+bool AnalysisCache::save() const
+{
+    Writer writer;
+    writer.data.append(kCacheMagic, sizeof(kCacheMagic));
+    writer.u32(kCacheFormatVersion);
+    writer.str(buildId);
+    writer.u32(uint32_t(mode));
+
+    writer.u32(uint32_t(entries.size()));
+    for (const auto& [name, entry] : entries)
+    {
+        writer.str(name);
+        writer.u64(entry.sourceHash);
+        writer.u64(entry.configHash);
+        writer.u32(entry.success ? 1 : 0);
+
+        writer.u32(uint32_t(entry.dependencies.size()));
+        for (const Luau::ModuleName& dependency : entry.dependencies)
+            writer.str(dependency);
+
+        writer.u32(uint32_t(entry.unresolvedRequires.size()));
+        for (const std::string& require : entry.unresolvedRequires)
+            writer.str(require);
+
+        writer.u32(uint32_t(entry.diagnostics.size()));
+        for (const Diagnostic& diagnostic : entry.diagnostics)
+        {
+            writer.str(diagnostic.name);
+            writer.u32(diagnostic.location.begin.line);
+            writer.u32(diagnostic.location.begin.column);
+            writer.u32(diagnostic.location.end.line);
+            writer.u32(diagnostic.location.end.column);
+            writer.str(diagnostic.type);
+            writer.str(diagnostic.message);
+        }
+    }
+
+    // write next to the destination and rename so that concurrent runs never read a partial file
+    std::string tempPath = path + "." + std::to_string(getpid()) + ".tmp";
+
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file)
+        return false;
+
+    bool written = fwrite(writer.data.data(), 1, writer.data.size(), file) == writer.data.size();
+    written = (fclose(file) == 0) && written;
+
+    if (!written || rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        unlink(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool AnalysisCache::isClean(const Luau::ModuleName& name)
+{
+    if (auto it = cleanMemo.find(name); it != cleanMemo.end())
+        return it->second;
+
+    // clean only if every module reachable through recorded dependencies is unchanged; walking the whole closure
+    // instead of recursing on isClean keeps require cycles from caching a provisional answer
+    std::vector<Luau::ModuleName> stack = {name};
+    std::unordered_map<Luau::ModuleName, bool> visited;
+    bool clean = true;
+
+    while (clean && !stack.empty())
+    {
+        Luau::ModuleName current = std::move(stack.back());
+        stack.pop_back();
+
+        if (!visited.emplace(current, true).second)
+            continue;
+
+        auto it = entries.find(current);
+        if (it == entries.end() || current == "-")
+        {
+            clean = false;
+            break;
+        }
+
+        std::optional<uint64_t> hash = currentSourceHash(current);
+        if (!hash || *hash != it->second.sourceHash || currentConfigHash(current) != it->second.configHash)
+        {
+            clean = false;
+            break;
+        }
+
+        // a module created since then would now be required instead of reported missing
+        for (const std::string& require : it->second.unresolvedRequires)
+        {
+            if (FileResolver::resolveRequire(current, require))
+            {
+                clean = false;
+                break;
+            }
+        }
+
+        if (!clean)
+            break;
+
+        for (const Luau::ModuleName& dependency : it->second.dependencies)
+            stack.push_back(dependency);
+    }
+
+    return cleanMemo[name] = clean;
+}
+
+int AnalysisCache::replay(const Luau::ModuleName& name, ReportFormat format, std::unordered_set<Luau::ModuleName>& reported) const
+{
+    int failed = 0;
+
+    replayRec(name, format, reported, failed);
+
+    return failed;
+}
+
+void AnalysisCache::record(const Luau::ModuleName& name, Entry entry)
+{
+    entry.configHash = currentConfigHash(name);
+    entries[name] = std::move(entry);
+
+    // dependents of this module may have memoized answers too
+    cleanMemo.clear();
+    hashMemo.erase(name);
+}
+
+std::vector<Luau::ModuleName> AnalysisCache::getDependencies(const Luau::Frontend& frontend, const Luau::ModuleName& name)
+{
+    std::vector<Luau::ModuleName> dependencies;
+
+    auto it = frontend.sourceNodes.find(name);
+    if (it != frontend.sourceNodes.end())
+        dependencies.assign(it->second->requireSet.begin(), it->second->requireSet.end());
+
+    return dependencies;
+}
+
+std::optional<uint64_t> AnalysisCache::currentSourceHash(const Luau::ModuleName& name)
+{
+    if (auto it = hashMemo.find(name); it != hashMemo.end())
+        return it->second;
+
+    std::optional<uint64_t> hash;
+    if (std::optional<SourceFile> source = SourceFile::open(name))
+        hash = hashBytes(source->view().data(), source->view().size());
+
+    return hashMemo[name] = hash;
+}
+
+uint64_t AnalysisCache::currentConfigHash(const Luau::ModuleName& name)
+{
+    uint64_t hash = 0;
+
+    // the same chain of directories ConfigResolver merges configs from, nearest first
+    for (std::optional<std::string> directory = getParentPath(name); directory; directory = getParentPath(*directory))
+    {
+        std::string configPath = joinPaths(*directory, Luau::kConfigName);
+
+        auto it = configMemo.find(configPath);
+        if (it == configMemo.end())
+        {
+            std::optional<std::string> contents = readFile(configPath);
+            // an empty file still differs from a missing one
+            uint64_t fileHash = contents ? hashBytes(contents->data(), contents->size(), 1) : 0;
+
+            it = configMemo.emplace(configPath, fileHash).first;
+        }
+
+        hash = hashBytes(&it->second, sizeof(it->second), hash);
+    }
+
+    return hash;
+}
+
+void AnalysisCache::replayRec(const Luau::ModuleName& name, ReportFormat format, std::unordered_set<Luau::ModuleName>& reported, int& failed)
+    const
+{
+    if (!reported.insert(name).second)
+        return;
+
+    auto it = entries.find(name);
+    if (it == entries.end())
+        return;
+
+    // Frontend reports dependencies before the modules that require them
+    for (const Luau::ModuleName& dependency : it->second.dependencies)
+        replayRec(dependency, format, reported, failed);
+
+    for (const Diagnostic& diagnostic : it->second.diagnostics)
+        report(format, diagnostic);
+
+    failed += !it->second.success;
+}
+
+}
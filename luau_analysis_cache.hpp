@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Luau/Frontend.h"
+#include "luau_utils.hpp"
+
+namespace LuauUtils
+{
+    // Per-module analysis results persisted between runs.
+    // A module is clean when its source and the .luaurc files that apply to it hash the same as when it was
+    // recorded, none of its unresolved requires resolve now and all of its dependencies are clean, in which case its
+    // diagnostics can be replayed without creating a Frontend at all.
+    class AnalysisCache
+    {
+    public:
+        struct Entry
+        {
+            uint64_t sourceHash = 0;
+            // set by record
+            uint64_t configHash = 0;
+            bool success = true;
+            std::vector<Luau::ModuleName> dependencies;
+            // normalized require strings that resolved to no module
+            std::vector<std::string> unresolvedRequires;
+            std::vector<Diagnostic> diagnostics;
+        };
+
+        AnalysisCache(std::string path, std::string buildId, Luau::Mode mode);
+
+        // Returns false if the file is missing, unreadable or was written by a different build or mode
+        bool load();
+        bool save() const;
+
+        // True if the module and its transitive dependencies are unchanged since they were recorded
+        bool isClean(const Luau::ModuleName& name);
+
+        // Replays stored diagnostics of the module and its dependencies, in dependency order, skipping modules in
+        // reported and adding the rest to it; returns the failure count of the modules it replayed
+        int replay(const Luau::ModuleName& name, ReportFormat format, std::unordered_set<Luau::ModuleName>& reported) const;
+
+        // Stamps the entry with the current hash of the module's .luaurc files
+        void record(const Luau::ModuleName& name, Entry entry);
+
+        // Direct dependencies of a checked module, as resolved by the Frontend
+        static std::vector<Luau::ModuleName> getDependencies(const Luau::Frontend& frontend, const Luau::ModuleName& name);
+
+    private:
+        std::optional<uint64_t> currentSourceHash(const Luau::ModuleName& name);
+        uint64_t currentConfigHash(const Luau::ModuleName& name);
+        void replayRec(const Luau::ModuleName& name, ReportFormat format, std::unordered_set<Luau::ModuleName>& reported, int& failed) const;
+
+        std::string path;
+        std::string buildId;
+        Luau::Mode mode;
+
+        std::unordered_map<Luau::ModuleName, Entry> entries;
+        std::unordered_map<Luau::ModuleName, bool> cleanMemo;
+        std::unordered_map<Luau::ModuleName, std::optional<uint64_t>> hashMemo;
+        // by config file path, 0 for a missing file
+        std::unordered_map<std::string, uint64_t> configMemo;
+    };
+}
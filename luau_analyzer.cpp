@@ -0,0 +1,515 @@
+#include "luau_analyzer.hpp"
+#include "luau_actor.hpp"
+#include "luau_batch.hpp"
+#include "luau_runtime.hpp"
+#include "luau_source.hpp"
+#include "luau_trace.hpp"
+#include "Luau/BuiltinDefinitions.h"
+#include "Luau/BytecodeBuilder.h"
+#include "Luau/Compiler.h"
+#include "Luau/FileUtils.h"
+#include "Luau/TypeAttach.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <system_error>
+#include <unordered_set>
+
+#include <glob.h>
+
+namespace LuauUtils {
+
+Analyzer::Analyzer(Luau::Mode mode, ReportFormat format, unsigned threadCount, bool retainForCompile)
+    : format(format)
+    , configResolver(mode)
+    , frontend(&fileResolver, &configResolver, makeFrontendOptions(annotate || (retainForCompile && globalOptions.codegen)))
+    , threadCount(threadCount)
+    , scheduler(threadCount)
+{
+    if (retainForCompile)
+    {
+        fileResolver.setSourceObserver(
+            [this](const Luau::ModuleName& name, std::string_view source)
+            {
+                PrecompiledChunks::SourceKey key = PrecompiledChunks::SourceKey::of(source);
+
+                std::unique_lock guard(sourceKeysMutex);
+                sourceKeys[name] = key;
+            }
+        );
+    }
+    Luau::registerBuiltinGlobals(frontend, frontend.globals);
+    frontend.loadDefinitionFile(frontend.globals, frontend.globals.globalScope, kEventLoopDefinitions, "@luau_utils", false);
+    frontend.loadDefinitionFile(frontend.globals, frontend.globals.globalScope, kActorDefinitions, "@luau_utils", false);
+    Luau::freeze(frontend.globals.globalTypes);
+}
+
+int Analyzer::check(const std::vector<std::string>& files, AnalysisCache* cache, std::unordered_set<Luau::ModuleName>* reported)
+{
+    using Clock = std::chrono::steady_clock;
+
+    for (const std::string& path : files)
+        frontend.queueModuleCheck(path);
+
+    struct TaskTimes
+    {
+        std::atomic<uint64_t> busyNanoseconds{0};
+        std::atomic<uint64_t> longestNanoseconds{0};
+        std::atomic<size_t> count{0};
+    } times;
+
+    Clock::time_point checkStart = Clock::now();
+
+    try
+    {
+        frontend.checkQueuedModules(
+            std::nullopt,
+            [&](std::function<void()> f)
+            {
+                scheduler.push(
+                    [times = &times, f = std::move(f)]
+                    {
+                        Clock::time_point start = Clock::now();
+                        {
+                            // one task per module; the thread it lands on names the worker in the trace
+                            TraceSpan span("analysis", "check module");
+                            f();
+                        }
+                        uint64_t elapsed = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+
+                        times->busyNanoseconds.fetch_add(elapsed, std::memory_order_relaxed);
+                        times->count.fetch_add(1, std::memory_order_relaxed);
+
+                        uint64_t longest = times->longestNanoseconds.load(std::memory_order_relaxed);
+                        while (elapsed > longest && !times->longestNanoseconds.compare_exchange_weak(longest, elapsed, std::memory_order_relaxed))
+                        {
+                        }
+                    }
+                );
+            }
+        );
+    }
+    catch (const Luau::InternalCompilerError& ice)
+    {
+        Luau::Location location = ice.location ? *ice.location : Luau::Location();
+
+        std::string moduleName = ice.moduleName ? *ice.moduleName : "<unknown module>";
+
+        Luau::TypeError error(location, moduleName, Luau::InternalError{ice.message});
+
+        reportError(frontend, format, error);
+        return 1;
+    }
+
+    Clock::time_point reportStart = Clock::now();
+
+    // checkQueuedModules only returns once every task it pushed has finished
+    checkStats.threads = threadCount;
+    checkStats.tasks = times.count.load();
+    checkStats.checkSeconds = std::chrono::duration<double>(reportStart - checkStart).count();
+    checkStats.busySeconds = double(times.busyNanoseconds.load()) / 1e9;
+    checkStats.longestTaskSeconds = double(times.longestNanoseconds.load()) / 1e9;
+
+    int failed = 0;
+
+    std::vector<Luau::ModuleName> order = dependencyOrder(files);
+    checkStats.modules = order.size();
+    checkStats.longestChain = longestRequireChain(order);
+
+    for (const Luau::ModuleName& name : order)
+    {
+        if (reported && !reported->insert(name).second)
+            continue;
+
+        std::vector<Diagnostic> diagnostics;
+        bool success = reportModuleResult(frontend, name, format, annotate, cache ? &diagnostics : nullptr);
+        failed += !success;
+
+        if (cache)
+        {
+            if (std::optional<uint64_t> sourceHash = fileResolver.getSourceHash(name))
+            {
+                AnalysisCache::Entry entry;
+                entry.sourceHash = *sourceHash;
+                entry.success = success;
+                entry.dependencies = AnalysisCache::getDependencies(frontend, name);
+                entry.unresolvedRequires = fileResolver.getUnresolvedRequires(name);
+                entry.diagnostics = std::move(diagnostics);
+                cache->record(name, std::move(entry));
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, std::string>> configErrors = configResolver.getErrors();
+    if (!configErrors.empty())
+    {
+        failed += int(configErrors.size());
+
+        for (const auto& pair : configErrors)
+            fprintf(stderr, "%s: %s\n", pair.first.c_str(), pair.second.c_str());
+    }
+
+    checkStats.reportSeconds = std::chrono::duration<double>(Clock::now() - reportStart).count();
+
+    return failed;
+}
+
+void Analyzer::refresh()
+{
+    std::vector<Luau::ModuleName> changed;
+
+    // a config edit can change the result of any module below it, which the Frontend doesn't track
+    if (configResolver.refresh())
+    {
+        for (const auto& [name, node] : frontend.sourceNodes)
+            changed.push_back(name);
+    }
+
+    for (const auto& [name, node] : frontend.sourceNodes)
+    {
+        std::error_code ec;
+        FileStamp stamp;
+        stamp.mtime = std::filesystem::last_write_time(name, ec);
+        stamp.size = ec ? 0 : std::filesystem::file_size(name, ec);
+
+        auto it = stamps.find(name);
+        if (it != stamps.end() && it->second == stamp)
+            continue;
+
+        bool firstSeen = it == stamps.end();
+        stamps[name] = stamp;
+
+        // the first time a module is seen its stamp can't be compared, so fall back to the hash of what was read
+        if (firstSeen)
+        {
+            std::optional<SourceFile> source = SourceFile::open(name);
+            std::optional<uint64_t> hash = fileResolver.getSourceHash(name);
+
+            if (source && hash && hashBytes(source->view().data(), source->view().size()) == *hash)
+                continue;
+        }
+
+        changed.push_back(name);
+    }
+
+    for (const Luau::ModuleName& name : changed)
+        frontend.markDirty(name);
+}
+
+size_t Analyzer::compileModules(const std::vector<std::string>& files, PrecompiledChunks& chunks, bool attachTypes)
+{
+    size_t compiled = 0;
+
+    for (const Luau::ModuleName& name : dependencyOrder(files))
+    {
+        Luau::SourceModule* sourceModule = frontend.getSourceModule(name);
+
+        std::optional<PrecompiledChunks::SourceKey> key;
+        {
+            std::unique_lock guard(sourceKeysMutex);
+            if (auto it = sourceKeys.find(name); it != sourceKeys.end())
+                key = it->second;
+        }
+
+        // modules that didn't parse are left for the runtime, which reports the error when compiling them
+        if (!sourceModule || !sourceModule->root || !sourceModule->parseErrors.empty() || !key)
+            continue;
+
+        if (attachTypes)
+        {
+            if (Luau::ModulePtr module = frontend.moduleResolver.getModule(name))
+                Luau::attachTypeData(*sourceModule, *module);
+        }
+
+        Luau::ParseResult parseResult;
+        parseResult.root = sourceModule->root;
+        parseResult.hotcomments = sourceModule->hotcomments;
+
+        try
+        {
+            TraceSpan span("compile", "compile", name);
+
+            Luau::BytecodeBuilder bcb;
+            Luau::compileOrThrow(bcb, parseResult, *sourceModule->names, copts());
+            chunks.add(*key, bcb.getBytecode());
+            compiled++;
+        }
+        catch (const Luau::CompileError&)
+        {
+        }
+    }
+
+    return compiled;
+}
+
+FileResolver& Analyzer::getFileResolver()
+{
+    return fileResolver;
+}
+
+const Analyzer::CheckStats& Analyzer::getCheckStats() const
+{
+    return checkStats;
+}
+
+bool Analyzer::hasConfigErrors() const
+{
+    return !configResolver.getErrors().empty();
+}
+
+Luau::Frontend& Analyzer::getFrontend()
+{
+    return frontend;
+}
+
+Luau::FrontendOptions Analyzer::makeFrontendOptions(bool retainTypes)
+{
+    Luau::FrontendOptions frontendOptions;
+    frontendOptions.retainFullTypeGraphs = retainTypes;
+    frontendOptions.runLintChecks = true;
+    return frontendOptions;
+}
+
+std::vector<Luau::ModuleName> Analyzer::dependencyOrder(const std::vector<std::string>& files) const
+{
+    std::vector<Luau::ModuleName> order;
+    std::unordered_set<Luau::ModuleName> visited;
+
+    // post-order walk so that dependencies are reported before the modules requiring them
+    std::function<void(const Luau::ModuleName&)> visit = [&](const Luau::ModuleName& name)
+    {
+        if (!visited.insert(name).second)
+            return;
+
+        auto it = frontend.sourceNodes.find(name);
+        if (it == frontend.sourceNodes.end())
+            return;
+
+        for (const Luau::ModuleName& dependency : it->second->requireSet)
+            visit(dependency);
+
+        order.push_back(name);
+    };
+
+    for (const std::string& path : files)
+        visit(path);
+
+    return order;
+}
+
+size_t Analyzer::longestRequireChain(const std::vector<Luau::ModuleName>& order) const
+{
+    // order has dependencies first, so each module's chain can be computed from those of its dependencies
+    std::unordered_map<Luau::ModuleName, size_t> chain;
+    size_t longest = 0;
+
+    for (const Luau::ModuleName& name : order)
+    {
+        size_t length = 1;
+
+        auto it = frontend.sourceNodes.find(name);
+        if (it != frontend.sourceNodes.end())
+        {
+            for (const Luau::ModuleName& dependency : it->second->requireSet)
+            {
+                auto found = chain.find(dependency);
+                if (found != chain.end())
+                    length = std::max(length, found->second + 1);
+            }
+        }
+
+        chain[name] = length;
+        longest = std::max(longest, length);
+    }
+
+    return longest;
+}
+
+std::vector<std::string> collectModuleFiles(const std::vector<std::string>& inputs)
+{
+    std::vector<std::string> files;
+    std::unordered_set<std::string> seen;
+
+    auto add = [&](const std::string& path)
+    {
+        std::string normalized = normalizePath(path);
+        if (seen.insert(normalized).second)
+            files.push_back(std::move(normalized));
+    };
+
+    auto isModule = [](const std::string& path)
+    {
+        std::string_view view = path;
+        return (view.size() > 5 && view.substr(view.size() - 5) == ".luau") || (view.size() > 4 && view.substr(view.size() - 4) == ".lua");
+    };
+
+    for (const std::string& input : inputs)
+    {
+        if (!input.empty() && input[0] == '@')
+        {
+            if (std::optional<std::vector<std::string>> list = readManifest(input.substr(1)))
+            {
+                for (const std::string& path : *list)
+                    add(path);
+            }
+            else
+            {
+                fprintf(stderr, "Could not read file list %s\n", input.c_str() + 1);
+            }
+        }
+        else if (input.find_first_of("*?[") != std::string::npos)
+        {
+            glob_t matches = {};
+            if (glob(input.c_str(), GLOB_NOSORT, nullptr, &matches) == 0)
+            {
+                std::vector<std::string> paths(matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+                std::sort(paths.begin(), paths.end());
+
+                // a pattern that matches directories stands for the modules in them
+                for (const std::string& path : paths)
+                {
+                    if (isDirectory(path))
+                    {
+                        std::vector<std::string> nested = collectModuleFiles({path});
+                        for (const std::string& file : nested)
+                            add(file);
+                    }
+                    else if (isModule(path))
+                    {
+                        add(path);
+                    }
+                }
+            }
+            globfree(&matches);
+        }
+        else if (isDirectory(input))
+        {
+            std::vector<std::string> found;
+            traverseDirectory(
+                input,
+                [&](const std::string& path)
+                {
+                    if (isModule(path))
+                        found.push_back(path);
+                }
+            );
+
+            // traversal order depends on the file system
+            std::sort(found.begin(), found.end());
+            for (const std::string& path : found)
+                add(path);
+        }
+        else
+        {
+            add(input);
+        }
+    }
+
+    return files;
+}
+
+// Time per phase, and for the check phase how busy the workers were compared to what the require graph allows
+static void reportAnalysisStats(const Analyzer::CheckStats& stats, double cacheSeconds, double compileSeconds, double totalSeconds) {
+    double available = stats.checkSeconds * stats.threads;
+    double averageTask = stats.tasks ? stats.busySeconds / stats.tasks : 0.0;
+
+    fprintf(stderr, "analysis: %zu modules on %u threads in %.2f ms\n", stats.modules, stats.threads, totalSeconds * 1000);
+    fprintf(stderr, "  cache    %10.2f ms\n", cacheSeconds * 1000);
+    fprintf(stderr, "  check    %10.2f ms  %zu tasks, %.2f ms busy, %.1f%% utilization, longest task %.2f ms\n",
+        stats.checkSeconds * 1000, stats.tasks, stats.busySeconds * 1000, available > 0 ? 100.0 * stats.busySeconds / available : 0.0,
+        stats.longestTaskSeconds * 1000);
+    fprintf(stderr, "  report   %10.2f ms\n", stats.reportSeconds * 1000);
+    fprintf(stderr, "  compile  %10.2f ms\n", compileSeconds * 1000);
+
+    // when the chain estimate is close to the check time, more threads won't help; when it's far below and
+    // utilization is low, the time goes to scheduling
+    fprintf(stderr, "  longest require chain: %zu modules, about %.2f ms at the average task time; average parallelism %.1f\n",
+        stats.longestChain, stats.longestChain * averageTask * 1000, stats.checkSeconds > 0 ? stats.busySeconds / stats.checkSeconds : 0.0);
+}
+
+bool analyzeLuau(const std::vector<std::string>& files, const AnalyzeOptions& options) {
+    using Clock = std::chrono::steady_clock;
+
+    Luau::assertHandler() = LuauUtils::assertionHandler;
+
+    LuauUtils::ReportFormat format = LuauUtils::ReportFormat::Default;
+    Luau::Mode mode = Luau::Mode::Strict;
+    bool annotate = false;
+    unsigned threadCount = options.threadCount;
+    std::string basePath = "";
+
+    int failed = 0;
+
+    Clock::time_point start = Clock::now();
+
+    // modules whose whole dependency closure is unchanged replay their previous results instead of being checked
+    std::unique_ptr<LuauUtils::AnalysisCache> analysisCache;
+    if (!globalOptions.analysisCachePath.empty() && !annotate) {
+        analysisCache = std::make_unique<LuauUtils::AnalysisCache>(globalOptions.analysisCachePath, globalOptions.buildId, mode);
+        analysisCache->load();
+    }
+
+    // shared by every replay and the check, so that a module several inputs require is reported and counted once
+    std::unordered_set<Luau::ModuleName> reported;
+
+    std::vector<std::string> dirtyFiles;
+    for (const std::string& path : files) {
+        if (analysisCache && analysisCache->isClean(path))
+            failed += analysisCache->replay(path, format, reported);
+        else
+            dirtyFiles.push_back(path);
+    }
+
+    double cacheSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (dirtyFiles.empty())
+        return failed == 0;
+
+    // every core; the scheduler's workers steal from each other, so this scales past the old limit of 8
+    if (threadCount == 0)
+        threadCount = LuauUtils::WorkStealingScheduler::getThreadCount();
+
+    LuauUtils::Analyzer analyzer(mode, format, threadCount, options.compileInto != nullptr);
+
+    for (const auto& [name, source] : options.sources)
+        analyzer.getFileResolver().addSource(name, source);
+
+    failed += analyzer.check(dirtyFiles, analysisCache.get(), &reported);
+
+    Clock::time_point compileStart = Clock::now();
+
+    // the analyzer is discarded right after, so its ASTs can take the checked types
+    if (options.compileInto && failed == 0)
+        analyzer.compileModules(dirtyFiles, *options.compileInto, globalOptions.codegen);
+
+    double compileSeconds = std::chrono::duration<double>(Clock::now() - compileStart).count();
+
+    Clock::time_point saveStart = Clock::now();
+
+    // config errors aren't tied to a module, so a run that hits them isn't remembered
+    if (analysisCache && !analyzer.hasConfigErrors())
+        analysisCache->save();
+
+    cacheSeconds += std::chrono::duration<double>(Clock::now() - saveStart).count();
+
+    if (globalOptions.analysisStats)
+        reportAnalysisStats(analyzer.getCheckStats(), cacheSeconds, compileSeconds, std::chrono::duration<double>(Clock::now() - start).count());
+
+    // if (format == ReportFormat::Luacheck) {
+	// 	// return 0;
+	// } else {
+    //     // return failed ? 1 : 0;
+	// }
+
+    // std::cout << "DONE ANALYZING - FAILED: " << failed << std::endl;
+	// std::cout << "DONE ANALYZING" << std::endl;
+
+    return failed == 0;
+}
+
+bool analyzeLuau(const std::string& scriptFilePath) {
+    return analyzeLuau(std::vector<std::string>{scriptFilePath});
+}
+
+}
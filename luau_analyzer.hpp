@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Luau/Frontend.h"
+
+#include "luau_utils.hpp"
+#include "luau_analysis_cache.hpp"
+#include "luau_precompiled.hpp"
+#include "luau_work_stealing.hpp"
+
+namespace LuauUtils
+{
+    // Owns a Frontend together with its resolvers and worker pool so that it can be kept warm across checks
+    class Analyzer
+    {
+    public:
+        // retainForCompile keeps what compileModules needs: a key for the source of every module and, for type info,
+        // the full type graphs
+        Analyzer(Luau::Mode mode, ReportFormat format, unsigned threadCount, bool retainForCompile = false);
+
+        // Checks files and everything they require and reports the diagnostics of that whole closure, including modules
+        // that were already up to date. Results are recorded in cache when one is given. Modules in reported, like
+        // those a cache replayed, are neither reported nor counted again; the rest are added to it. Returns the
+        // failure count.
+        int check(
+            const std::vector<std::string>& files,
+            AnalysisCache* cache = nullptr,
+            std::unordered_set<Luau::ModuleName>* reported = nullptr
+        );
+
+        // Marks modules whose files changed on disk since they were last read as dirty, along with their dependents
+        void refresh();
+
+        // Compiles files and everything they require from the ASTs the last check built, skipping a re-parse at load
+        // time. With attachTypes the checked types are written into the ASTs as annotations first, which the compiler
+        // turns into type info for native codegen; that changes the ASTs, so the Analyzer must not check again after.
+        // Returns the number of modules compiled.
+        size_t compileModules(const std::vector<std::string>& files, PrecompiledChunks& chunks, bool attachTypes);
+
+        FileResolver& getFileResolver();
+
+        // Where the last check spent its time; workers record how long they were busy so that utilization can be
+        // told apart from a dependency graph that doesn't have enough independent modules
+        struct CheckStats
+        {
+            unsigned threads = 0;
+            size_t modules = 0;
+            size_t tasks = 0;
+            double checkSeconds = 0.0;
+            double busySeconds = 0.0;
+            double longestTaskSeconds = 0.0;
+            double reportSeconds = 0.0;
+            // modules on the longest require chain, which have to be checked one after another
+            size_t longestChain = 0;
+        };
+
+        const CheckStats& getCheckStats() const;
+
+        // files and every module they require as of the last check, dependencies first
+        std::vector<Luau::ModuleName> dependencyOrder(const std::vector<std::string>& files) const;
+
+        bool hasConfigErrors() const;
+        Luau::Frontend& getFrontend();
+
+    private:
+        struct FileStamp
+        {
+            std::filesystem::file_time_type mtime;
+            uintmax_t size = 0;
+
+            bool operator==(const FileStamp& other) const
+            {
+                return mtime == other.mtime && size == other.size;
+            }
+        };
+
+        static Luau::FrontendOptions makeFrontendOptions(bool retainTypes);
+        size_t longestRequireChain(const std::vector<Luau::ModuleName>& order) const;
+
+        ReportFormat format;
+        bool annotate = false;
+
+        FileResolver fileResolver;
+        ConfigResolver configResolver;
+        Luau::Frontend frontend;
+        unsigned threadCount;
+        WorkStealingScheduler scheduler;
+        CheckStats checkStats;
+
+        std::unordered_map<Luau::ModuleName, FileStamp> stamps;
+
+        // keys of the sources the Frontend read, recorded when retaining for compileModules
+        std::mutex sourceKeysMutex;
+        std::unordered_map<Luau::ModuleName, PrecompiledChunks::SourceKey> sourceKeys;
+    };
+
+    struct AnalyzeOptions
+    {
+        // sources the caller has already read, used instead of reading those files again; must outlive the call
+        std::unordered_map<std::string, std::string_view> sources;
+
+        // when set and analysis passes, the checked modules are compiled into it from their ASTs
+        PrecompiledChunks* compileInto = nullptr;
+
+        // worker threads, 0 for one per core
+        unsigned threadCount = 0;
+    };
+
+    // Expands directories (every .luau and .lua file below them), globs and @file lists of paths into module paths,
+    // in a stable order and without duplicates. Anything else is taken as a path to a module.
+    std::vector<std::string> collectModuleFiles(const std::vector<std::string>& inputs);
+
+    // Analyzes all files in a single checkQueuedModules pass, replaying cached results for unchanged ones
+    bool analyzeLuau(const std::vector<std::string>& files, const AnalyzeOptions& options = {});
+    bool analyzeLuau(const std::string& scriptFilePath);
+}
@@ -0,0 +1,212 @@
+#include "luau_batch.hpp"
+#include "luau_analyzer.hpp"
+#include "luau_runtime.hpp"
+#include "luau_source.hpp"
+#include "luau_work_stealing.hpp"
+#include "Luau/FileUtils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+
+namespace LuauUtils {
+
+namespace {
+
+struct ScriptResult
+{
+    std::string output;
+    int status = LUA_OK;
+    double seconds = 0.0;
+    bool done = false;
+};
+
+struct Batch
+{
+    const std::vector<std::string>& files;
+    std::vector<ScriptResult> results;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+};
+
+void runOne(Batch& batch, size_t index)
+{
+    const std::string& path = batch.files[index];
+    auto start = std::chrono::steady_clock::now();
+
+    std::string output;
+    int status = LUA_ERRRUN;
+
+    if (std::optional<SourceFile> source = SourceFile::open(path))
+    {
+        if (lua_State* L = createState())
+        {
+            status = runScript(L, source->view(), /* sandboxed= */ false, "@" + path, &output);
+            closeState(L, &output);
+        }
+        else
+        {
+            output = "Failed to create Lua state\n";
+            status = LUA_ERRMEM;
+        }
+    }
+    else
+    {
+        output = "Error: Could not open file " + path + "\n";
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    {
+        std::unique_lock guard(batch.mtx);
+
+        ScriptResult& result = batch.results[index];
+        result.output = std::move(output);
+        result.status = status;
+        result.seconds = seconds;
+        result.done = true;
+    }
+
+    batch.cv.notify_all();
+}
+
+// nearest-rank percentile of sorted samples
+double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+
+    size_t rank = size_t(std::ceil(p * double(sorted.size())));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+}
+
+std::optional<std::vector<std::string>> readManifest(const std::string& manifestPath)
+{
+    std::optional<std::string> contents = readFile(manifestPath);
+    if (!contents)
+        return std::nullopt;
+
+    std::optional<std::string> base = getParentPath(manifestPath);
+
+    std::vector<std::string> files;
+    std::istringstream lines(*contents);
+    std::string line;
+
+    while (std::getline(lines, line))
+    {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#')
+            continue;
+
+        size_t end = line.find_last_not_of(" \t\r");
+        std::string path = line.substr(begin, end - begin + 1);
+
+        if (base && !base->empty() && !isAbsolutePath(path))
+            path = joinPaths(*base, path);
+
+        files.push_back(std::move(path));
+    }
+
+    return files;
+}
+
+int runBatch(const std::vector<std::string>& files, const BatchOptions& options)
+{
+    if (files.empty())
+    {
+        fprintf(stderr, "Error: batch has no scripts\n");
+        return 1;
+    }
+
+    // one pass over the whole batch, so shared dependencies are only checked once
+    if (options.runAnalyzer)
+    {
+        if (!precompiledChunks)
+            precompiledChunks = std::make_unique<PrecompiledChunks>();
+
+        // scripts and their modules are compiled from the checked ASTs, so workers only read and load them
+        AnalyzeOptions analyzeOptions;
+        analyzeOptions.compileInto = precompiledChunks.get();
+
+        if (!analyzeLuau(files, analyzeOptions))
+            return 1;
+    }
+
+    unsigned jobs = options.jobs ? options.jobs : WorkStealingScheduler::getThreadCount();
+    jobs = std::min(jobs, unsigned(files.size()));
+
+    Batch batch{files, std::vector<ScriptResult>(files.size()), {}, {}};
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<double> latencies;
+    latencies.reserve(files.size());
+    size_t failed = 0;
+
+    {
+        WorkStealingScheduler scheduler(jobs);
+
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            scheduler.push(
+                [&batch, i]
+                {
+                    runOne(batch, i);
+                }
+            );
+        }
+
+        // results are printed as soon as every script before them has finished
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            std::unique_lock guard(batch.mtx);
+            batch.cv.wait(
+                guard,
+                [&]
+                {
+                    return batch.results[i].done;
+                }
+            );
+
+            ScriptResult result = std::move(batch.results[i]);
+            guard.unlock();
+
+            printf("==> %s <==\n", files[i].c_str());
+            fwrite(result.output.data(), 1, result.output.size(), stdout);
+            fflush(stdout);
+
+            latencies.push_back(result.seconds);
+            failed += result.status != LUA_OK;
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+
+    fprintf(
+        stderr,
+        "batch: %zu scripts (%zu failed) on %u threads in %.3f s, %.1f scripts/s, latency p50 %.3f ms, p99 %.3f ms\n",
+        files.size(),
+        failed,
+        jobs,
+        elapsed,
+        elapsed > 0 ? double(files.size()) / elapsed : 0.0,
+        percentile(latencies, 0.50) * 1000,
+        percentile(latencies, 0.99) * 1000
+    );
+
+    if (globalOptions.codegen)
+        reportCodegenStats();
+
+    return failed ? 1 : 0;
+}
+
+}
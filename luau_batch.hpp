@@ -0,0 +1,24 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace LuauUtils
+{
+    struct BatchOptions
+    {
+        // worker threads running scripts; 0 uses one per hardware thread
+        unsigned jobs = 0;
+        bool runAnalyzer = true;
+    };
+
+    // Reads a manifest with one script path per line; blank lines and lines starting with '#' are skipped.
+    // Relative paths are taken relative to the directory of the manifest.
+    std::optional<std::vector<std::string>> readManifest(const std::string& manifestPath);
+
+    // Analyzes all files together, then runs each of them in its own state on a pool of worker threads.
+    // Output is captured per script and printed in the order the files were given, followed by a throughput summary
+    // on stderr. Returns 0 if every script analyzed and ran without errors.
+    int runBatch(const std::vector<std::string>& files, const BatchOptions& options);
+}
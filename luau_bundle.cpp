@@ -0,0 +1,451 @@
+#include "luau_bundle.hpp"
+#include "luau_preload.hpp"
+#include "luau_runtime.hpp"
+#include "luau_trace.hpp"
+#include "luau_utils.hpp"
+#include "Luau/BytecodeBuilder.h"
+#include "Luau/Compiler.h"
+#include "Luau/Parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+namespace LuauUtils {
+
+struct Bundle::Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t moduleCount;
+    uint32_t requireCount;
+    uint32_t entry;
+    // options the modules were compiled with, for diagnostics
+    uint8_t optimizationLevel;
+    uint8_t debugLevel;
+    uint8_t coverageLevel;
+    uint8_t reserved[5];
+};
+
+struct Bundle::ModuleRecord
+{
+    uint64_t nameOffset;
+    uint64_t bytecodeOffset;
+    uint32_t nameSize;
+    uint32_t bytecodeSize;
+};
+
+struct Bundle::RequireRecord
+{
+    uint64_t pathOffset;
+    uint32_t pathSize;
+    uint32_t from;
+    uint32_t to;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(Bundle::Header) == 32 && sizeof(Bundle::ModuleRecord) == 24 && sizeof(Bundle::RequireRecord) == 24);
+
+std::optional<Bundle> Bundle::open(const std::string& path, std::string& error)
+{
+    std::optional<SourceFile> file = SourceFile::map(path);
+    if (!file)
+    {
+        error = "could not open " + path;
+        return std::nullopt;
+    }
+
+    Bundle bundle;
+    bundle.file = std::move(*file);
+
+    std::string_view data = bundle.file.view();
+
+    if (data.size() < sizeof(Header) || memcmp(data.data(), kMagic, sizeof(kMagic)) != 0)
+    {
+        error = path + " is not a bundle";
+        return std::nullopt;
+    }
+
+    const Header& header = bundle.header();
+    if (header.version != kVersion)
+    {
+        error = path + " is a version " + std::to_string(header.version) + " bundle, expected version " + std::to_string(kVersion);
+        return std::nullopt;
+    }
+
+    uint64_t indexEnd = sizeof(Header) + uint64_t(header.moduleCount) * sizeof(ModuleRecord) + uint64_t(header.requireCount) * sizeof(RequireRecord);
+    if (indexEnd > data.size() || header.entry >= header.moduleCount)
+    {
+        error = path + " has a truncated index";
+        return std::nullopt;
+    }
+
+    // everything the index points at has to be inside the file, so lookups don't need to check again
+    auto inside = [&](uint64_t offset, uint64_t size)
+    {
+        return offset <= data.size() && size <= data.size() - offset;
+    };
+
+    for (uint32_t i = 0; i < header.moduleCount; i++)
+    {
+        const ModuleRecord& module = bundle.modules()[i];
+        if (!inside(module.nameOffset, module.nameSize) || !inside(module.bytecodeOffset, module.bytecodeSize))
+        {
+            error = path + " has a corrupt module record";
+            return std::nullopt;
+        }
+    }
+
+    for (uint32_t i = 0; i < header.requireCount; i++)
+    {
+        const RequireRecord& record = bundle.requireRecords()[i];
+        if (!inside(record.pathOffset, record.pathSize) || record.from >= header.moduleCount || record.to >= header.moduleCount)
+        {
+            error = path + " has a corrupt require record";
+            return std::nullopt;
+        }
+    }
+
+    return bundle;
+}
+
+uint32_t Bundle::getEntry() const
+{
+    return header().entry;
+}
+
+size_t Bundle::getModuleCount() const
+{
+    return header().moduleCount;
+}
+
+std::string_view Bundle::getName(uint32_t module) const
+{
+    return stringAt(modules()[module].nameOffset, modules()[module].nameSize);
+}
+
+std::string_view Bundle::getBytecode(uint32_t module) const
+{
+    return stringAt(modules()[module].bytecodeOffset, modules()[module].bytecodeSize);
+}
+
+std::optional<uint32_t> Bundle::findModule(std::string_view name) const
+{
+    const ModuleRecord* begin = modules();
+    const ModuleRecord* end = begin + header().moduleCount;
+
+    const ModuleRecord* it = std::lower_bound(
+        begin,
+        end,
+        name,
+        [this](const ModuleRecord& module, std::string_view name)
+        {
+            return stringAt(module.nameOffset, module.nameSize) < name;
+        }
+    );
+
+    if (it == end || stringAt(it->nameOffset, it->nameSize) != name)
+        return std::nullopt;
+
+    return uint32_t(it - begin);
+}
+
+std::optional<uint32_t> Bundle::resolveRequire(uint32_t from, std::string_view path) const
+{
+    const RequireRecord* begin = requireRecords();
+    const RequireRecord* end = begin + header().requireCount;
+
+    const RequireRecord* it = std::lower_bound(
+        begin,
+        end,
+        std::make_pair(from, path),
+        [this](const RequireRecord& record, const std::pair<uint32_t, std::string_view>& key)
+        {
+            return std::make_pair(record.from, stringAt(record.pathOffset, record.pathSize)) < key;
+        }
+    );
+
+    if (it == end || it->from != from || stringAt(it->pathOffset, it->pathSize) != path)
+        return std::nullopt;
+
+    return it->to;
+}
+
+const Bundle::Header& Bundle::header() const
+{
+    return *reinterpret_cast<const Header*>(file.view().data());
+}
+
+const Bundle::ModuleRecord* Bundle::modules() const
+{
+    return reinterpret_cast<const ModuleRecord*>(file.view().data() + sizeof(Header));
+}
+
+const Bundle::RequireRecord* Bundle::requireRecords() const
+{
+    return reinterpret_cast<const RequireRecord*>(file.view().data() + sizeof(Header) + header().moduleCount * sizeof(ModuleRecord));
+}
+
+std::string_view Bundle::stringAt(uint64_t offset, uint64_t size) const
+{
+    return file.view().substr(offset, size);
+}
+
+namespace {
+
+struct BundledModule
+{
+    std::string name;
+    std::string bytecode;
+    // require string as written in the source, and the name of the module it resolved to
+    std::map<std::string, std::string> requireTargets;
+};
+
+// Compiles name and queues the modules it requires; false after reporting an error
+bool compileModule(
+    FileResolver& fileResolver, const std::string& name, std::string_view source, BundledModule& module, std::vector<std::string>& queue,
+    std::unordered_map<std::string, size_t>& indices
+)
+{
+    Luau::Allocator allocator;
+    Luau::AstNameTable names(allocator);
+    Luau::ParseResult result = Luau::Parser::parse(source.data(), source.size(), names, allocator, Luau::ParseOptions());
+
+    if (!result.errors.empty())
+    {
+        for (const Luau::ParseError& error : result.errors)
+            report(ReportFormat::Default, name.c_str(), error.getLocation(), "SyntaxError", error.getMessage().c_str());
+        return false;
+    }
+
+    try
+    {
+        TraceSpan span("compile", "compile", name);
+
+        Luau::BytecodeBuilder bcb;
+        Luau::compileOrThrow(bcb, result, names, copts());
+        module.bytecode = bcb.getBytecode();
+    }
+    catch (const Luau::CompileError& error)
+    {
+        report(ReportFormat::Default, name.c_str(), error.getLocation(), "CompileError", error.what());
+        return false;
+    }
+
+    Luau::ModuleInfo context{name};
+
+    for (Luau::AstExpr* expr : collectRequireArguments(result.root))
+    {
+        Luau::AstExprConstantString* path = expr->as<Luau::AstExprConstantString>();
+        if (!path)
+            continue;
+
+        std::optional<Luau::ModuleInfo> info = fileResolver.resolveModule(&context, expr);
+        if (!info)
+        {
+            report(ReportFormat::Default, name.c_str(), expr->location, "BundleError", "could not resolve required module");
+            return false;
+        }
+
+        module.requireTargets[std::string(path->value.data, path->value.size)] = info->name;
+
+        if (indices.try_emplace(info->name, indices.size()).second)
+            queue.push_back(info->name);
+    }
+
+    return true;
+}
+
+void align(std::string& out)
+{
+    out.resize((out.size() + 7) & ~size_t(7), '\0');
+}
+
+template<typename T>
+void append(std::string& out, const T& value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+}
+
+bool writeBundle(const std::string& entryPath, std::string_view entrySource, const std::string& outputPath)
+{
+    FileResolver fileResolver;
+
+    // modules in the order they were found; indices maps names to positions in it
+    std::vector<BundledModule> found;
+    std::unordered_map<std::string, size_t> indices = {{entryPath, 0}};
+    std::vector<std::string> queue = {entryPath};
+
+    for (size_t next = 0; next < queue.size(); next++)
+    {
+        const std::string name = queue[next];
+
+        std::optional<SourceFile> file;
+        std::string_view source = entrySource;
+        if (next != 0)
+        {
+            file = SourceFile::open(name);
+            if (!file)
+            {
+                fprintf(stderr, "Could not open module %s\n", name.c_str());
+                return false;
+            }
+            source = file->view();
+        }
+
+        found.push_back({name, "", {}});
+        if (!compileModule(fileResolver, name, source, found.back(), queue, indices))
+            return false;
+    }
+
+    // sorted by name for Bundle::findModule
+    std::vector<uint32_t> order(found.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+        order[i] = i;
+
+    std::sort(
+        order.begin(),
+        order.end(),
+        [&](uint32_t a, uint32_t b)
+        {
+            return found[a].name < found[b].name;
+        }
+    );
+
+    std::vector<uint32_t> sortedIndex(found.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+        sortedIndex[order[i]] = i;
+
+    struct PendingRequire
+    {
+        uint32_t from;
+        uint32_t to;
+        std::string path;
+    };
+
+    std::vector<PendingRequire> requireList;
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        // requireTargets is a std::map, so requires come out sorted by path within each module
+        for (const auto& [path, target] : found[order[i]].requireTargets)
+            requireList.push_back({i, sortedIndex[indices[target]], path});
+    }
+
+    // strings and bytecode go after the index, so their offsets are known once its size is
+    size_t indexSize = sizeof(Bundle::Header) + found.size() * sizeof(Bundle::ModuleRecord) + requireList.size() * sizeof(Bundle::RequireRecord);
+
+    std::string blobs;
+    std::vector<std::pair<uint64_t, uint64_t>> nameOffsets(found.size());
+    std::vector<std::pair<uint64_t, uint64_t>> bytecodeOffsets(found.size());
+    std::vector<uint64_t> pathOffsets(requireList.size());
+
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        nameOffsets[i] = {indexSize + blobs.size(), found[order[i]].name.size()};
+        blobs += found[order[i]].name;
+    }
+
+    for (size_t i = 0; i < requireList.size(); i++)
+    {
+        pathOffsets[i] = indexSize + blobs.size();
+        blobs += requireList[i].path;
+    }
+
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        align(blobs);
+        bytecodeOffsets[i] = {indexSize + blobs.size(), found[order[i]].bytecode.size()};
+        blobs += found[order[i]].bytecode;
+    }
+
+    Luau::CompileOptions options = copts();
+
+    std::string out;
+    out.append(Bundle::kMagic, sizeof(Bundle::kMagic));
+    append(out, Bundle::kVersion);
+    append(out, uint32_t(found.size()));
+    append(out, uint32_t(requireList.size()));
+    append(out, sortedIndex[0]);
+    append(out, uint8_t(options.optimizationLevel));
+    append(out, uint8_t(options.debugLevel));
+    append(out, uint8_t(options.coverageLevel));
+    out.append(5, '\0');
+
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        append(out, nameOffsets[i].first);
+        append(out, bytecodeOffsets[i].first);
+        append(out, uint32_t(nameOffsets[i].second));
+        append(out, uint32_t(bytecodeOffsets[i].second));
+    }
+
+    for (size_t i = 0; i < requireList.size(); i++)
+    {
+        append(out, pathOffsets[i]);
+        append(out, uint32_t(requireList[i].path.size()));
+        append(out, requireList[i].from);
+        append(out, requireList[i].to);
+        append(out, uint32_t(0));
+    }
+
+    out += blobs;
+
+    // written next to the destination and renamed over it, so a running process never maps a partial bundle
+    std::string tempPath = outputPath + "." + std::to_string(getpid()) + ".tmp";
+
+    {
+        std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+        stream.write(out.data(), std::streamsize(out.size()));
+        if (!stream)
+        {
+            fprintf(stderr, "Could not write %s\n", tempPath.c_str());
+            unlink(tempPath.c_str());
+            return false;
+        }
+    }
+
+    if (rename(tempPath.c_str(), outputPath.c_str()) != 0)
+    {
+        fprintf(stderr, "Could not write %s\n", outputPath.c_str());
+        unlink(tempPath.c_str());
+        return false;
+    }
+
+    fprintf(stderr, "bundle: %zu modules, %zu bytes written to %s\n", found.size(), out.size(), outputPath.c_str());
+    return true;
+}
+
+bool runBundle(const std::string& path)
+{
+    std::string error;
+    std::optional<Bundle> opened = Bundle::open(path, error);
+    if (!opened)
+    {
+        fprintf(stderr, "Error: %s\n", error.c_str());
+        return false;
+    }
+
+    activeBundle = std::make_unique<Bundle>(std::move(*opened));
+
+    lua_State* L = createState();
+    if (!L)
+        return false;
+
+    std::string chunkname = "@" + std::string(activeBundle->getName(activeBundle->getEntry()));
+
+    bool success = loadBytecode(L, activeBundle->getBytecode(activeBundle->getEntry()), false, chunkname) == LUA_OK && resumeScript(L) == LUA_OK;
+
+    closeState(L);
+    activeBundle.reset();
+
+    return success;
+}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "luau_source.hpp"
+
+namespace LuauUtils
+{
+    // A script and its whole static require closure compiled into one file:
+    //
+    //   Header | ModuleRecord[moduleCount] | RequireRecord[requireCount] | names and require strings | bytecode
+    //
+    // Modules are sorted by name and requires by (requiring module, require string), so both are binary-searched
+    // straight out of the mapping without building anything at startup. Every offset is from the start of the file
+    // and all records are 8-byte aligned. Integers are stored in host byte order.
+    class Bundle
+    {
+    public:
+        // the on-disk records, defined next to the code that reads and writes them
+        struct Header;
+        struct ModuleRecord;
+        struct RequireRecord;
+
+        static constexpr char kMagic[8] = {'L', 'U', 'A', 'U', 'B', 'N', 'D', 'L'};
+        static constexpr uint32_t kVersion = 1;
+
+        // Maps path and validates its index; on failure error says why
+        static std::optional<Bundle> open(const std::string& path, std::string& error);
+
+        uint32_t getEntry() const;
+        size_t getModuleCount() const;
+
+        // module names are what lua_require sees as the path of a module, and its chunk name without the '@'
+        std::string_view getName(uint32_t module) const;
+        std::string_view getBytecode(uint32_t module) const;
+
+        std::optional<uint32_t> findModule(std::string_view name) const;
+        // the module that require(path) in from resolved to when the bundle was built
+        std::optional<uint32_t> resolveRequire(uint32_t from, std::string_view path) const;
+
+    private:
+        Bundle() = default;
+
+        // records are read in place; nothing is kept that a move of the file would invalidate
+        const Header& header() const;
+        const ModuleRecord* modules() const;
+        const RequireRecord* requireRecords() const;
+        std::string_view stringAt(uint64_t offset, uint64_t size) const;
+
+        SourceFile file;
+    };
+
+    // Compiles entryPath and every module it statically requires into a bundle at outputPath. Syntax and compile
+    // errors are reported and fail the build; requires that aren't string literals are left out and will fail at
+    // runtime.
+    bool writeBundle(const std::string& entryPath, std::string_view entrySource, const std::string& outputPath);
+
+    // Runs the entry module of the bundle at path with lua_require resolving against it instead of the file system
+    bool runBundle(const std::string& path);
+}
@@ -0,0 +1,242 @@
+#include "luau_bytecode_cache.hpp"
+#include "luau_source.hpp"
+#include "luau_utils.hpp"
+#include "Luau/Bytecode.h"
+#include "Luau/FileUtils.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace LuauUtils {
+
+namespace {
+
+constexpr char kEntryMagic[4] = {'L', 'B', 'C', 'C'};
+constexpr uint32_t kEntryFormatVersion = 1;
+constexpr uint64_t kMaxEntrySize = 1ull << 30;
+
+struct EntryHeader
+{
+    char magic[4];
+    uint32_t formatVersion;
+    uint64_t keyLo;
+    uint64_t keyHi;
+    uint64_t size;
+    uint64_t checksum;
+};
+
+// Accumulates the inputs that make up a cache key; both halves use independent seeds
+struct KeyBuilder
+{
+    uint64_t lo = 0x6a09e667f3bcc908ull;
+    uint64_t hi = 0xbb67ae8584caa73bull;
+
+    void add(const void* data, size_t size)
+    {
+        lo = hashBytes(data, size, lo);
+        hi = hashBytes(data, size, hi);
+    }
+
+    void add(int value)
+    {
+        add(&value, sizeof(value));
+    }
+
+    void add(const char* str)
+    {
+        // distinguish nullptr from an empty string
+        add(str ? 1 : 0);
+        if (str)
+            add(str, strlen(str));
+    }
+
+    void add(const char* const* list)
+    {
+        int count = 0;
+        for (; list && list[count]; count++)
+            add(list[count]);
+        add(count);
+    }
+};
+
+}
+
+BytecodeCache::BytecodeCache(std::string directory, std::string buildId)
+    : directory(std::move(directory))
+    , buildId(std::move(buildId))
+{
+    std::error_code ec;
+    std::filesystem::create_directories(this->directory, ec);
+}
+
+std::string BytecodeCache::compile(std::string_view source, const Luau::CompileOptions& options)
+{
+    Key key = makeKey(source, options);
+    std::string path = entryPath(key);
+
+    if (std::optional<std::string> bytecode = load(path, key))
+    {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return std::move(*bytecode);
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+
+    std::string bytecode = compileBytecode(source, options);
+
+    // compilation errors are encoded as a zero byte followed by the message; those aren't worth keeping
+    if (!bytecode.empty() && bytecode[0] != 0)
+        store(path, key, bytecode);
+
+    return bytecode;
+}
+
+void BytecodeCache::dumpStats(FILE* out) const
+{
+    fprintf(
+        out,
+        "bytecode cache: %llu hits, %llu misses, %llu rejected, %llu write failures (%s)\n",
+        (unsigned long long)hits.load(),
+        (unsigned long long)misses.load(),
+        (unsigned long long)rejected.load(),
+        (unsigned long long)writeFailures.load(),
+        directory.c_str()
+    );
+}
+
+uint64_t BytecodeCache::getHits() const
+{
+    return hits.load();
+}
+
+uint64_t BytecodeCache::getMisses() const
+{
+    return misses.load();
+}
+
+std::string BytecodeCache::defaultDirectory()
+{
+    if (const char* dir = getenv("LUAU_BYTECODE_CACHE"); dir && *dir)
+        return dir;
+
+    if (const char* xdg = getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return joinPaths(xdg, "luau-bytecode");
+
+    if (const char* home = getenv("HOME"); home && *home)
+        return joinPaths(joinPaths(home, ".cache"), "luau-bytecode");
+
+    return ".luau-bytecode";
+}
+
+std::string BytecodeCache::currentBuildId(const char* argv0)
+{
+    struct stat st;
+
+#ifdef __linux__
+    if (stat("/proc/self/exe", &st) == 0)
+        return std::to_string(st.st_size) + ":" + std::to_string(st.st_mtime);
+#endif
+
+    if (argv0 && stat(argv0, &st) == 0)
+        return std::to_string(st.st_size) + ":" + std::to_string(st.st_mtime);
+
+    return "";
+}
+
+BytecodeCache::Key BytecodeCache::makeKey(std::string_view source, const Luau::CompileOptions& options) const
+{
+    KeyBuilder builder;
+
+    builder.add(int(kEntryFormatVersion));
+    builder.add(int(LBC_VERSION_MIN));
+    builder.add(int(LBC_VERSION_MAX));
+    builder.add(int(LBC_VERSION_TARGET));
+    builder.add(buildId.c_str());
+
+    builder.add(options.optimizationLevel);
+    builder.add(options.debugLevel);
+    builder.add(options.typeInfoLevel);
+    builder.add(options.coverageLevel);
+    builder.add(options.vectorLib);
+    builder.add(options.vectorCtor);
+    builder.add(options.vectorType);
+    builder.add(options.mutableGlobals);
+    builder.add(options.userdataTypes);
+
+    builder.add(source.data(), source.size());
+
+    return {builder.lo, builder.hi};
+}
+
+std::string BytecodeCache::entryPath(const Key& key) const
+{
+    char name[40];
+    snprintf(name, sizeof(name), "%016llx%016llx.luauc", (unsigned long long)key.hi, (unsigned long long)key.lo);
+    return joinPaths(directory, name);
+}
+
+std::optional<std::string> BytecodeCache::load(const std::string& path, const Key& key)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return std::nullopt;
+
+    EntryHeader header;
+    std::optional<std::string> result;
+
+    if (fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, kEntryMagic, sizeof(kEntryMagic)) == 0 &&
+        header.formatVersion == kEntryFormatVersion && header.keyLo == key.lo && header.keyHi == key.hi && header.size <= kMaxEntrySize)
+    {
+        std::string bytecode(header.size, '\0');
+
+        if (fread(bytecode.data(), 1, bytecode.size(), file) == bytecode.size() &&
+            hashBytes(bytecode.data(), bytecode.size(), key.lo) == header.checksum)
+            result = std::move(bytecode);
+    }
+
+    fclose(file);
+
+    if (!result)
+        rejected.fetch_add(1, std::memory_order_relaxed);
+
+    return result;
+}
+
+void BytecodeCache::store(const std::string& path, const Key& key, const std::string& bytecode)
+{
+    static std::atomic<unsigned> tempCounter{0};
+
+    std::string tempPath = path + "." + std::to_string(getpid()) + "." + std::to_string(tempCounter.fetch_add(1)) + ".tmp";
+
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file)
+    {
+        writeFailures.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    EntryHeader header;
+    memcpy(header.magic, kEntryMagic, sizeof(kEntryMagic));
+    header.formatVersion = kEntryFormatVersion;
+    header.keyLo = key.lo;
+    header.keyHi = key.hi;
+    header.size = bytecode.size();
+    header.checksum = hashBytes(bytecode.data(), bytecode.size(), key.lo);
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(bytecode.data(), 1, bytecode.size(), file) == bytecode.size();
+    written = (fclose(file) == 0) && written;
+
+    // rename is atomic, so a concurrent reader sees either the old entry, no entry or the complete new one
+    if (!written || rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        unlink(tempPath.c_str());
+        writeFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+}
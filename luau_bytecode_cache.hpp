@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "Luau/Compiler.h"
+
+namespace LuauUtils
+{
+    // Content-addressed bytecode cache stored on disk.
+    // Entries are keyed on the source hash, every CompileOptions field that affects codegen,
+    // the bytecode version range of the linked Luau and an identifier of the running build.
+    // Entries are written to a temporary file and renamed into place, so concurrent processes
+    // sharing a directory only ever observe complete entries.
+    class BytecodeCache
+    {
+    public:
+        BytecodeCache(std::string directory, std::string buildId);
+
+        // Returns bytecode for source, compiling and storing it on a miss
+        std::string compile(std::string_view source, const Luau::CompileOptions& options);
+
+        void dumpStats(FILE* out) const;
+
+        uint64_t getHits() const;
+        uint64_t getMisses() const;
+
+        // $LUAU_BYTECODE_CACHE, then $XDG_CACHE_HOME/luau-bytecode, then ~/.cache/luau-bytecode
+        static std::string defaultDirectory();
+        // Identifies the running executable (size and mtime) so a rebuild invalidates old entries
+        static std::string currentBuildId(const char* argv0);
+
+    private:
+        struct Key
+        {
+            uint64_t lo = 0;
+            uint64_t hi = 0;
+        };
+
+        Key makeKey(std::string_view source, const Luau::CompileOptions& options) const;
+        std::string entryPath(const Key& key) const;
+        std::optional<std::string> load(const std::string& path, const Key& key);
+        void store(const std::string& path, const Key& key, const std::string& bytecode);
+
+        std::string directory;
+        std::string buildId;
+
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> rejected{0};
+        std::atomic<uint64_t> writeFailures{0};
+    };
+}
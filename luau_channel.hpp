@@ -0,0 +1,235 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace LuauUtils
+{
+    // Bounded multi-producer multi-consumer queue. Slots carry a sequence number that tells producers and consumers
+    // whose turn it is, so send and receive only contend on one atomic position each and never take a lock while the
+    // channel is neither full nor empty. Blocked callers spin briefly and then park, like WorkStealingScheduler
+    // workers. Closing wakes everyone: sends fail from then on and receives drain what is left.
+    template<typename T>
+    class BoundedChannel
+    {
+    public:
+        // capacity is rounded up to a power of two
+        explicit BoundedChannel(size_t capacity)
+        {
+            size_t size = 2;
+            while (size < capacity)
+                size *= 2;
+
+            cells.reset(new Cell[size]);
+            mask = size - 1;
+
+            for (size_t i = 0; i < size; i++)
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        BoundedChannel(const BoundedChannel&) = delete;
+        BoundedChannel& operator=(const BoundedChannel&) = delete;
+
+        // value is moved from only when it was queued
+        bool trySend(T& value)
+        {
+            if (closed.load() || !push(value))
+                return false;
+
+            wakeWaiters();
+            return true;
+        }
+
+        bool tryReceive(T& value)
+        {
+            if (!pop(value))
+                return false;
+
+            wakeWaiters();
+            return true;
+        }
+
+        // Blocks while the channel is full; false once it is closed
+        bool send(T value)
+        {
+            bool sent = false;
+
+            wait(
+                [&]
+                {
+                    if (closed.load())
+                        return true;
+
+                    sent = push(value);
+                    return sent;
+                }
+            );
+
+            if (sent)
+                wakeWaiters();
+
+            return sent;
+        }
+
+        // Blocks while the channel is empty; false once it is closed and drained
+        bool receive(T& value)
+        {
+            bool received = false;
+
+            wait(
+                [&]
+                {
+                    received = pop(value);
+                    return received || closed.load();
+                }
+            );
+
+            // a value sent right before close is still delivered
+            if (!received)
+                received = pop(value);
+
+            if (received)
+                wakeWaiters();
+
+            return received;
+        }
+
+        void close()
+        {
+            {
+                std::unique_lock guard(parkMutex);
+                closed.store(true);
+            }
+
+            parkCv.notify_all();
+        }
+
+        bool isClosed() const
+        {
+            return closed.load();
+        }
+
+    private:
+        static constexpr int kSpinRounds = 64;
+
+        struct alignas(64) Cell
+        {
+            std::atomic<size_t> sequence{0};
+            T value{};
+        };
+
+        bool push(T& value)
+        {
+            size_t pos = enqueuePos.load(std::memory_order_relaxed);
+
+            for (;;)
+            {
+                Cell& cell = cells[pos & mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+
+                // the slot is free for pos; behind means full, ahead means another producer took pos
+                if (diff == 0)
+                {
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        cell.value = std::move(value);
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool pop(T& value)
+        {
+            size_t pos = dequeuePos.load(std::memory_order_relaxed);
+
+            for (;;)
+            {
+                Cell& cell = cells[pos & mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(sequence) - intptr_t(pos + 1);
+
+                if (diff == 0)
+                {
+                    if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        value = std::move(cell.value);
+                        // frees the slot for the producer one lap ahead
+                        cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = dequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // ready is called under parkMutex once parked, so it must not wake waiters itself
+        template<typename Ready>
+        void wait(Ready ready)
+        {
+            for (int round = 0; round < kSpinRounds; round++)
+            {
+                if (ready())
+                    return;
+
+                std::this_thread::yield();
+            }
+
+            // counted before checking again, so that a sender or receiver either sees the waiter or is seen by it
+            waiting.fetch_add(1);
+
+            {
+                std::unique_lock guard(parkMutex);
+                parkCv.wait(guard, ready);
+            }
+
+            waiting.fetch_sub(1);
+        }
+
+        void wakeWaiters()
+        {
+            // orders the slot update before the check, pairing with the increment in wait
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (waiting.load() > 0)
+            {
+                std::unique_lock guard(parkMutex);
+                parkCv.notify_all();
+            }
+        }
+
+        std::unique_ptr<Cell[]> cells;
+        size_t mask = 0;
+
+        alignas(64) std::atomic<size_t> enqueuePos{0};
+        alignas(64) std::atomic<size_t> dequeuePos{0};
+
+        std::atomic<bool> closed{false};
+        std::atomic<unsigned> waiting{0};
+        std::mutex parkMutex;
+        std::condition_variable parkCv;
+    };
+}
@@ -0,0 +1,79 @@
+#include "luau_chunk_cache.hpp"
+
+namespace LuauUtils {
+
+ChunkCache::ChunkCache(size_t maxBytes)
+    : maxBytes(maxBytes)
+{
+}
+
+std::shared_ptr<const std::string> ChunkCache::find(const SourceKey& key)
+{
+    std::unique_lock guard(mtx);
+
+    auto it = entries.find(key);
+    if (it == entries.end())
+    {
+        misses++;
+        return nullptr;
+    }
+
+    hits++;
+    order.splice(order.begin(), order, it->second);
+    return it->second->bytecode;
+}
+
+void ChunkCache::add(const SourceKey& key, std::shared_ptr<const std::string> bytecode)
+{
+    size_t size = bytecode->size();
+    if (size > maxBytes)
+        return;
+
+    std::unique_lock guard(mtx);
+
+    // another state may have compiled the same source in the meantime
+    if (entries.count(key))
+        return;
+
+    while (bytes + size > maxBytes && !order.empty())
+    {
+        bytes -= order.back().bytecode->size();
+        entries.erase(order.back().key);
+        order.pop_back();
+        evictions++;
+    }
+
+    order.push_front({key, std::move(bytecode)});
+    entries[key] = order.begin();
+    bytes += size;
+}
+
+void ChunkCache::dumpStats(FILE* out) const
+{
+    std::unique_lock guard(mtx);
+
+    fprintf(
+        out,
+        "chunk cache: %llu hits, %llu misses, %llu evictions, %zu chunks in %zu of %zu bytes\n",
+        (unsigned long long)hits,
+        (unsigned long long)misses,
+        (unsigned long long)evictions,
+        entries.size(),
+        bytes,
+        maxBytes
+    );
+}
+
+uint64_t ChunkCache::getHits() const
+{
+    std::unique_lock guard(mtx);
+    return hits;
+}
+
+uint64_t ChunkCache::getMisses() const
+{
+    std::unique_lock guard(mtx);
+    return misses;
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "luau_precompiled.hpp"
+
+namespace LuauUtils
+{
+    // Bounded in-memory LRU of compiled chunks for sources that are compiled over and over, like the templated code
+    // scripts pass to loadstring in loops. Keyed by source contents only: the chunk name is given to luau_load and
+    // compile options are fixed per process, so neither changes the bytecode. Shared by all states of the process.
+    class ChunkCache
+    {
+    public:
+        using SourceKey = PrecompiledChunks::SourceKey;
+
+        // maxBytes bounds the bytecode held; a single chunk larger than that is never cached
+        explicit ChunkCache(size_t maxBytes);
+
+        // The cached bytecode for key, which becomes the most recently used entry; nullptr on a miss
+        std::shared_ptr<const std::string> find(const SourceKey& key);
+        void add(const SourceKey& key, std::shared_ptr<const std::string> bytecode);
+
+        void dumpStats(FILE* out) const;
+
+        uint64_t getHits() const;
+        uint64_t getMisses() const;
+
+    private:
+        struct KeyHash
+        {
+            size_t operator()(const SourceKey& key) const
+            {
+                return size_t(key.hash);
+            }
+        };
+
+        struct Entry
+        {
+            SourceKey key;
+            std::shared_ptr<const std::string> bytecode;
+        };
+
+        size_t maxBytes = 0;
+        size_t bytes = 0;
+
+        mutable std::mutex mtx;
+        // most recently used first
+        std::list<Entry> order;
+        std::unordered_map<SourceKey, std::list<Entry>::iterator, KeyHash> entries;
+
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+}
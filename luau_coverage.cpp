@@ -0,0 +1,166 @@
+#include "luau_coverage.hpp"
+#include "luau_runtime.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace LuauUtils {
+
+namespace {
+
+struct FunctionKey
+{
+    std::string source;
+    std::string name;
+    int linedefined = 0;
+
+    bool operator<(const FunctionKey& other) const
+    {
+        return std::tie(source, linedefined, name) < std::tie(other.source, other.linedefined, other.name);
+    }
+};
+
+struct FunctionHits
+{
+    uint64_t calls = 0;
+    std::map<int, uint64_t> lines;
+};
+
+// totals of every state, keyed by function so that the same module loaded into several states adds up
+std::mutex coverageMutex;
+std::map<FunctionKey, FunctionHits> coverageTotals;
+
+struct CollectContext
+{
+    std::string source;
+};
+
+void collectFunction(void* context, const char* function, int linedefined, int depth, const int* hits, size_t size)
+{
+    CollectContext* ctx = static_cast<CollectContext*>(context);
+
+    FunctionKey key;
+    key.source = ctx->source;
+    key.linedefined = linedefined;
+
+    if (depth == 0)
+        key.name = "<main>";
+    else if (function)
+        key.name = std::string(function) + ":" + std::to_string(linedefined);
+    else
+        key.name = "<anonymous>:" + std::to_string(linedefined);
+
+    FunctionHits& totals = coverageTotals[key];
+    bool entered = false;
+
+    // -1 marks lines without code; the first covered line is hit once per call
+    for (size_t line = 0; line < size; line++)
+    {
+        if (hits[line] < 0)
+            continue;
+
+        if (!entered)
+        {
+            totals.calls += hits[line];
+            entered = true;
+        }
+
+        totals.lines[int(line)] += hits[line];
+    }
+}
+
+}
+
+bool coverageActive()
+{
+    return !globalOptions.coveragePath.empty();
+}
+
+void coverageTrack(lua_State* L, int funcindex)
+{
+    getStateData(L)->coverageRefs.push_back(lua_ref(L, funcindex));
+}
+
+void coverageCollect(lua_State* L)
+{
+    StateData* data = getStateData(L);
+    if (!data || data->coverageRefs.empty())
+        return;
+
+    std::unique_lock guard(coverageMutex);
+
+    for (int ref : data->coverageRefs)
+    {
+        lua_getref(L, ref);
+
+        lua_Debug ar = {};
+        lua_getinfo(L, -1, "s", &ar);
+
+        // short_src is truncated; file chunks are named "@" followed by their full path
+        CollectContext context{ar.source[0] == '@' ? ar.source + 1 : ar.short_src};
+        lua_getcoverage(L, -1, &context, collectFunction);
+
+        lua_pop(L, 1);
+        lua_unref(L, ref);
+    }
+
+    data->coverageRefs.clear();
+}
+
+bool coverageDump(const std::string& path)
+{
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+
+    std::unique_lock guard(coverageMutex);
+
+    fprintf(f, "TN:\n");
+
+    auto it = coverageTotals.begin();
+    while (it != coverageTotals.end())
+    {
+        const std::string& source = it->first.source;
+
+        // a line that belongs to several functions, like the one a closure is defined on, counts its most frequent one
+        std::map<int, uint64_t> lines;
+        size_t functions = 0;
+        size_t functionsHit = 0;
+
+        fprintf(f, "SF:%s\n", source.c_str());
+
+        for (auto fn = it; fn != coverageTotals.end() && fn->first.source == source; ++fn)
+            fprintf(f, "FN:%d,%s\n", fn->first.linedefined, fn->first.name.c_str());
+
+        for (; it != coverageTotals.end() && it->first.source == source; ++it)
+        {
+            fprintf(f, "FNDA:%llu,%s\n", (unsigned long long)it->second.calls, it->first.name.c_str());
+
+            functions++;
+            if (it->second.calls)
+                functionsHit++;
+
+            for (const auto& [line, hits] : it->second.lines)
+                lines[line] = std::max(lines[line], hits);
+        }
+
+        fprintf(f, "FNF:%zu\nFNH:%zu\n", functions, functionsHit);
+
+        size_t linesHit = 0;
+        for (const auto& [line, hits] : lines)
+        {
+            fprintf(f, "DA:%d,%llu\n", line, (unsigned long long)hits);
+            if (hits)
+                linesHit++;
+        }
+
+        fprintf(f, "LF:%zu\nLH:%zu\n", lines.size(), linesHit);
+        fprintf(f, "end_of_record\n");
+    }
+
+    return fclose(f) == 0;
+}
+
+}
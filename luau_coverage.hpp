@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+#include "lua.h"
+
+namespace LuauUtils
+{
+    // Coverage of every chunk compiled while --coverage is active. Chunks are compiled with coverage level 2, so the
+    // VM counts hits itself and collection costs no more than a counter increment per covered statement/expression.
+    bool coverageActive();
+
+    // Keeps the function at funcindex alive for coverageCollect; for main chunks and modules, nested functions are
+    // reached through them
+    void coverageTrack(lua_State* L, int funcindex);
+
+    // Adds the hit counts of every function tracked in L to the totals; must happen before L is closed
+    void coverageCollect(lua_State* L);
+
+    // Writes the totals of all states collected so far as an lcov tracefile
+    bool coverageDump(const std::string& path);
+}
@@ -0,0 +1,572 @@
+#include "luau_daemon.hpp"
+#include "luau_analyzer.hpp"
+#include "luau_channel.hpp"
+#include "luau_runtime.hpp"
+#include "luau_source.hpp"
+#include "luau_state_pool.hpp"
+#include "luau_utils.hpp"
+#include "Luau/FileUtils.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace LuauUtils {
+
+namespace {
+
+// Requests run one at a time, since each changes the working directory and redirects the output of the whole
+// process, so a single pooled state is enough; it is prepared ahead of time so that a request never pays for
+// luaL_newstate and luaL_openlibs
+constexpr size_t kPooledStates = 1;
+constexpr uint32_t kMaxRequestSize = 64 << 20;
+
+// Requests are read on threads of their own, so a client that connects and stalls only ties up a reader, and only
+// until the timeout drops it
+constexpr unsigned kReaderThreads = 4;
+constexpr int kReceiveTimeoutSeconds = 5;
+// read requests waiting for the one running
+constexpr size_t kQueuedRequests = 64;
+
+bool readAll(int fd, void* data, size_t size)
+{
+    char* ptr = static_cast<char*>(data);
+
+    while (size > 0)
+    {
+        ssize_t n = read(fd, ptr, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+
+        ptr += n;
+        size -= size_t(n);
+    }
+
+    return true;
+}
+
+bool writeAll(int fd, const void* data, size_t size)
+{
+    const char* ptr = static_cast<const char*>(data);
+
+    while (size > 0)
+    {
+        ssize_t n = write(fd, ptr, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+
+        ptr += n;
+        size -= size_t(n);
+    }
+
+    return true;
+}
+
+void appendString(std::string& out, const std::string& value)
+{
+    uint32_t size = uint32_t(value.size());
+    out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.append(value);
+}
+
+bool readString(const std::string& data, size_t& offset, std::string& value)
+{
+    uint32_t size = 0;
+    if (data.size() - offset < sizeof(size))
+        return false;
+
+    memcpy(&size, data.data() + offset, sizeof(size));
+    offset += sizeof(size);
+
+    if (data.size() - offset < size)
+        return false;
+
+    value = data.substr(offset, size);
+    offset += size;
+    return true;
+}
+
+std::string encodeRequest(const DaemonRequest& request)
+{
+    std::string payload;
+    appendString(payload, request.cwd);
+    appendString(payload, request.script);
+    appendString(payload, request.scriptFilePath);
+    payload.push_back(request.runAnalyzer ? 1 : 0);
+    return payload;
+}
+
+bool decodeRequest(const std::string& payload, DaemonRequest& request)
+{
+    size_t offset = 0;
+
+    if (!readString(payload, offset, request.cwd) || !readString(payload, offset, request.script) ||
+        !readString(payload, offset, request.scriptFilePath) || offset + 1 != payload.size())
+        return false;
+
+    request.runAnalyzer = payload[offset] != 0;
+    return true;
+}
+
+bool makeAddress(const std::string& socketPath, sockaddr_un& addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (socketPath.size() >= sizeof(addr.sun_path))
+        return false;
+
+    memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    return true;
+}
+
+// The socket runs arbitrary scripts for whoever connects, so it lives in a directory that only its owner can enter,
+// which also keeps other users from putting a socket of their own in its place
+bool makePrivateDirectory(const std::string& path)
+{
+    if (mkdir(path.c_str(), 0700) != 0 && errno != EEXIST)
+        return false;
+
+    struct stat st;
+    return lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode) && st.st_uid == getuid() && (st.st_mode & 077) == 0;
+}
+
+// both ends check that the other runs as the same user
+bool isSameUser(int connection)
+{
+#ifdef __linux__
+    ucred cred;
+    socklen_t length = sizeof(cred);
+
+    return getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &cred, &length) == 0 && cred.uid == getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+
+    return getpeereid(connection, &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+
+// SOCK_CLOEXEC and accept4 are Linux extensions; elsewhere the flag is set right after, which is as good since the
+// daemon never forks while a socket is being opened
+#ifndef __linux__
+int setCloseOnExec(int fd)
+{
+    if (fd >= 0)
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    return fd;
+}
+#endif
+
+int openSocket()
+{
+#ifdef __linux__
+    return socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+#else
+    return setCloseOnExec(socket(AF_UNIX, SOCK_STREAM, 0));
+#endif
+}
+
+int acceptConnection(int listener)
+{
+#ifdef __linux__
+    return accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+#else
+    return setCloseOnExec(accept(listener, nullptr, nullptr));
+#endif
+}
+
+// Receives the payload size together with the client's stdout and stderr descriptors
+bool receiveHeader(int connection, uint32_t& size, int (&fds)[2])
+{
+    char control[CMSG_SPACE(sizeof(int) * 2)];
+    memset(control, 0, sizeof(control));
+
+    iovec iov;
+    iov.iov_base = &size;
+    iov.iov_len = sizeof(size);
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(connection, &msg, 0) != ssize_t(sizeof(size)))
+        return false;
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(int) * 2))
+        return false;
+
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * 2);
+    return true;
+}
+
+bool sendHeader(int connection, uint32_t size, int outFd, int errFd)
+{
+    char control[CMSG_SPACE(sizeof(int) * 2)];
+    memset(control, 0, sizeof(control));
+
+    iovec iov;
+    iov.iov_base = &size;
+    iov.iov_len = sizeof(size);
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * 2);
+
+    int fds[2] = {outFd, errFd};
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    return sendmsg(connection, &msg, 0) == ssize_t(sizeof(size));
+}
+
+// Points stdout and stderr at the client's descriptors for the duration of a request
+class OutputRedirect
+{
+public:
+    OutputRedirect(int outFd, int errFd)
+    {
+        flush();
+        savedOut = dup(STDOUT_FILENO);
+        savedErr = dup(STDERR_FILENO);
+        dup2(outFd, STDOUT_FILENO);
+        dup2(errFd, STDERR_FILENO);
+    }
+
+    ~OutputRedirect()
+    {
+        flush();
+        dup2(savedOut, STDOUT_FILENO);
+        dup2(savedErr, STDERR_FILENO);
+        close(savedOut);
+        close(savedErr);
+    }
+
+private:
+    static void flush()
+    {
+        std::cout.flush();
+        std::cerr.flush();
+        fflush(stdout);
+        fflush(stderr);
+    }
+
+    int savedOut = -1;
+    int savedErr = -1;
+};
+
+// A request that was read completely, waiting to run
+struct PendingRequest
+{
+    int connection = -1;
+    int fds[2] = {-1, -1};
+    DaemonRequest request;
+};
+
+void closeConnection(int connection, const int (&fds)[2])
+{
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    close(connection);
+}
+
+std::optional<PendingRequest> readRequest(int connection)
+{
+    PendingRequest pending;
+    pending.connection = connection;
+
+    uint32_t size = 0;
+    std::string payload;
+
+    if (receiveHeader(connection, size, pending.fds) && size <= kMaxRequestSize)
+    {
+        payload.resize(size);
+
+        if (readAll(connection, payload.data(), payload.size()) && decodeRequest(payload, pending.request))
+            return pending;
+    }
+
+    closeConnection(connection, pending.fds);
+    return std::nullopt;
+}
+
+class Daemon
+{
+public:
+    Daemon()
+        : pool(kPooledStates)
+    {
+    }
+
+    // keeps a prepared state ready so that a request never waits for setup
+    void replenish()
+    {
+        pool.warm(1);
+    }
+
+    int handle(const DaemonRequest& request)
+    {
+        if (chdir(request.cwd.c_str()) != 0)
+        {
+            std::cout << "Error: Could not change directory to " << request.cwd << std::endl;
+            return 1;
+        }
+
+        std::string_view script = request.script;
+        std::optional<SourceFile> file;
+
+        if (!request.scriptFilePath.empty())
+        {
+            file = SourceFile::open(request.scriptFilePath);
+            if (!file)
+            {
+                std::cout << "Error: Could not open file " << request.scriptFilePath << std::endl;
+                return 1;
+            }
+
+            script = file->view();
+
+            if (request.runAnalyzer && !analyze(request))
+                return 1;
+        }
+
+        if (pool.run(script) == StatePool::RunStatus::StateLost)
+        {
+            std::cout << "Error: the Luau state became unrecoverable and was discarded" << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+private:
+    bool analyze(const DaemonRequest& request)
+    {
+        // module names are relative to the working directory, so every directory gets its own Frontend
+        std::unique_ptr<Analyzer>& analyzer = analyzers[request.cwd];
+
+        // every core, like analyzeLuau
+        if (!analyzer)
+            analyzer = std::make_unique<Analyzer>(Luau::Mode::Strict, ReportFormat::Default, WorkStealingScheduler::getThreadCount());
+        else
+            analyzer->refresh();
+
+        return analyzer->check({request.scriptFilePath}) == 0;
+    }
+
+    std::unordered_map<std::string, std::unique_ptr<Analyzer>> analyzers;
+    StatePool pool;
+};
+
+}
+
+std::string defaultDaemonSocketPath()
+{
+    if (const char* runtimeDir = getenv("XDG_RUNTIME_DIR"); runtimeDir && *runtimeDir)
+        return joinPaths(runtimeDir, "luau-daemon.sock");
+
+    return "/tmp/luau-daemon-" + std::to_string(getuid()) + "/daemon.sock";
+}
+
+int runDaemon(const std::string& socketPath)
+{
+    Luau::assertHandler() = assertionHandler;
+
+    // a client going away mid-request must not take the daemon down with it
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un addr;
+    if (!makeAddress(socketPath, addr))
+    {
+        fprintf(stderr, "Error: socket path is too long: %s\n", socketPath.c_str());
+        return 1;
+    }
+
+    std::string directory = getParentPath(socketPath).value_or(".");
+    if (!makePrivateDirectory(directory))
+    {
+        fprintf(stderr, "Error: %s must be a directory that only you can access\n", directory.c_str());
+        return 1;
+    }
+
+    int listener = openSocket();
+    if (listener < 0)
+    {
+        perror("socket");
+        return 1;
+    }
+
+    // a leftover socket file from a daemon that exited uncleanly is removed, a live one is left alone
+    if (connect(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0)
+    {
+        fprintf(stderr, "Error: a daemon is already listening on %s\n", socketPath.c_str());
+        close(listener);
+        return 1;
+    }
+
+    close(listener);
+    unlink(socketPath.c_str());
+
+    listener = openSocket();
+
+    // the socket is created without access for anyone else, rather than restricted after the fact
+    mode_t previousMask = umask(077);
+    bool bound = listener >= 0 && bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    umask(previousMask);
+
+    if (!bound || chmod(socketPath.c_str(), 0600) != 0 || listen(listener, 16) != 0)
+    {
+        perror("bind");
+        return 1;
+    }
+
+    Daemon daemon;
+    daemon.replenish();
+
+    fprintf(stderr, "Listening on %s\n", socketPath.c_str());
+
+    BoundedChannel<PendingRequest> requests(kQueuedRequests);
+    TaskScheduler readers(kReaderThreads);
+
+    std::thread acceptor(
+        [&]
+        {
+            for (;;)
+            {
+                int connection = acceptConnection(listener);
+                if (connection < 0)
+                {
+                    if (errno == EINTR || errno == ECONNABORTED)
+                        continue;
+
+                    perror("accept");
+                    break;
+                }
+
+                if (!isSameUser(connection))
+                {
+                    close(connection);
+                    continue;
+                }
+
+                timeval timeout = {kReceiveTimeoutSeconds, 0};
+                setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+                readers.push(
+                    [&requests, connection]
+                    {
+                        std::optional<PendingRequest> pending = readRequest(connection);
+
+                        if (pending && !requests.send(std::move(*pending)))
+                            closeConnection(pending->connection, pending->fds);
+                    }
+                );
+            }
+
+            requests.close();
+        }
+    );
+
+    PendingRequest pending;
+    while (requests.receive(pending))
+    {
+        int32_t exitCode = 1;
+
+        {
+            OutputRedirect redirect(pending.fds[0], pending.fds[1]);
+
+            try
+            {
+                exitCode = daemon.handle(pending.request);
+            }
+            catch (const std::exception& e)
+            {
+                std::cout << "ERROR: " << e.what() << std::endl;
+            }
+        }
+
+        writeAll(pending.connection, &exitCode, sizeof(exitCode));
+        closeConnection(pending.connection, pending.fds);
+
+        // done after replying so that preparing the next state doesn't add to request latency
+        daemon.replenish();
+    }
+
+    acceptor.join();
+
+    close(listener);
+    unlink(socketPath.c_str());
+    return 1;
+}
+
+std::optional<int> runDaemonClient(const std::string& socketPath, const DaemonRequest& request)
+{
+    sockaddr_un addr;
+    if (!makeAddress(socketPath, addr))
+        return std::nullopt;
+
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0)
+        return std::nullopt;
+
+    // a socket someone else is listening on gets neither the script nor this process' output
+    if (connect(connection, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || !isSameUser(connection))
+    {
+        close(connection);
+        return std::nullopt;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    std::string payload = encodeRequest(request);
+    int32_t exitCode = 1;
+
+    bool ok = sendHeader(connection, uint32_t(payload.size()), STDOUT_FILENO, STDERR_FILENO) &&
+              writeAll(connection, payload.data(), payload.size()) && readAll(connection, &exitCode, sizeof(exitCode));
+
+    close(connection);
+
+    if (!ok)
+    {
+        fprintf(stderr, "Error: lost connection to daemon at %s\n", socketPath.c_str());
+        return 1;
+    }
+
+    return exitCode;
+}
+
+}
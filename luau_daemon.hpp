@@ -0,0 +1,28 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+namespace LuauUtils
+{
+    // What the CLI would otherwise do in-process: optionally analyze a file, then run it or an inline script
+    struct DaemonRequest
+    {
+        std::string cwd;
+        std::string script;
+        std::string scriptFilePath;
+        bool runAnalyzer = true;
+    };
+
+    // $XDG_RUNTIME_DIR/luau-daemon.sock, or a socket in a per-user directory in /tmp
+    std::string defaultDaemonSocketPath();
+
+    // Serves requests on a Unix domain socket until the process is terminated. The socket's directory is created if
+    // needed and must be accessible to its owner only; connections from other users are refused.
+    // A warm Analyzer is kept per working directory and scripts run on a pooled sandboxed state.
+    int runDaemon(const std::string& socketPath);
+
+    // Sends the request along with this process' stdout and stderr, which the daemon writes to directly.
+    // Returns the exit code of the request, or nullopt if no daemon of this user is listening.
+    std::optional<int> runDaemonClient(const std::string& socketPath, const DaemonRequest& request);
+}
@@ -0,0 +1,625 @@
+#include "luau_event_loop.hpp"
+#include "luau_runtime.hpp"
+#include "luau_utils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <system_error>
+
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
+#include <time.h>
+#include <unistd.h>
+
+#include "lualib.h"
+
+namespace LuauUtils {
+
+namespace {
+
+// file operations block a worker each, so a few are enough to keep the disk busy without a thread per task
+constexpr unsigned kIoThreads = 4;
+
+// longer waits are clamped so that the deadline can't overflow
+constexpr double kMaxWaitSeconds = 1e9;
+
+uint64_t monotonicNow()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + uint64_t(ts.tv_nsec);
+}
+
+uint64_t deadlineAfter(double seconds)
+{
+    return monotonicNow() + uint64_t(std::min(seconds, kMaxWaitSeconds) * 1e9);
+}
+
+std::string errorMessage(const std::string& path)
+{
+    return path + ": " + std::generic_category().message(errno);
+}
+
+#ifdef __linux__
+void addToEpoll(int epollFd, int fd)
+{
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+#endif
+
+}
+
+#ifdef __linux__
+EventLoop::EventLoop()
+    : epollFd(epoll_create1(EPOLL_CLOEXEC))
+    , timerFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC))
+    , eventFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if (isValid())
+    {
+        addToEpoll(epollFd, timerFd);
+        addToEpoll(epollFd, eventFd);
+    }
+}
+
+EventLoop::~EventLoop()
+{
+    io.reset();
+
+    for (int fd : {epollFd, timerFd, eventFd})
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+}
+#else
+EventLoop::EventLoop() = default;
+
+EventLoop::~EventLoop()
+{
+    io.reset();
+}
+#endif
+
+EventLoop* EventLoop::get(lua_State* L)
+{
+    StateData* data = getStateData(L);
+
+    if (!data->loop)
+        data->loop = new EventLoop;
+
+    if (!data->loop->isValid())
+        luaL_error(L, "could not set up the event loop");
+
+    return data->loop;
+}
+
+EventLoop::Wakeup EventLoop::suspend(lua_State* T)
+{
+    Wakeup wakeup;
+    wakeup.thread = T;
+
+    lua_pushthread(T);
+    wakeup.ref = lua_ref(T, -1);
+    lua_pop(T, 1);
+
+    suspended.insert(T);
+    return wakeup;
+}
+
+void EventLoop::wake(Wakeup wakeup, int nargs)
+{
+    wakeup.nargs = nargs;
+    ready.push_back(wakeup);
+}
+
+void EventLoop::schedule(lua_State* T, int nargs, double seconds)
+{
+    Wakeup wakeup = suspend(T);
+    wakeup.nargs = nargs;
+
+    if (seconds > 0)
+        addTimer(deadlineAfter(seconds), wakeup);
+    else
+        ready.push_back(wakeup);
+}
+
+int EventLoop::sleep(lua_State* T, double seconds)
+{
+    Wakeup wakeup = suspend(T);
+    wakeup.waitStart = monotonicNow();
+
+    if (seconds > 0)
+        addTimer(deadlineAfter(seconds), wakeup);
+    else
+        ready.push_back(wakeup);
+
+    return lua_yield(T, 0);
+}
+
+int EventLoop::readFile(lua_State* T, std::string path)
+{
+    submit(
+        suspend(T),
+        [path = std::move(path)]
+        {
+            Completion completion;
+            completion.isRead = true;
+
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                completion.value = errorMessage(path);
+                return completion;
+            }
+
+            char buffer[64 * 1024];
+            for (;;)
+            {
+                ssize_t length = ::read(fd, buffer, sizeof(buffer));
+                if (length < 0 && errno == EINTR)
+                    continue;
+
+                if (length < 0)
+                {
+                    completion.value = errorMessage(path);
+                    close(fd);
+                    return completion;
+                }
+
+                if (length == 0)
+                    break;
+
+                completion.value.append(buffer, size_t(length));
+            }
+
+            close(fd);
+            completion.success = true;
+            return completion;
+        }
+    );
+
+    return lua_yield(T, 0);
+}
+
+int EventLoop::writeFile(lua_State* T, std::string path, std::string contents)
+{
+    submit(
+        suspend(T),
+        [path = std::move(path), contents = std::move(contents)]
+        {
+            Completion completion;
+
+            int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0)
+            {
+                completion.value = errorMessage(path);
+                return completion;
+            }
+
+            for (size_t offset = 0; offset < contents.size();)
+            {
+                ssize_t length = ::write(fd, contents.data() + offset, contents.size() - offset);
+                if (length < 0 && errno == EINTR)
+                    continue;
+
+                if (length < 0)
+                {
+                    completion.value = errorMessage(path);
+                    close(fd);
+                    return completion;
+                }
+
+                offset += size_t(length);
+            }
+
+            if (close(fd) != 0)
+            {
+                completion.value = errorMessage(path);
+                return completion;
+            }
+
+            completion.success = true;
+            return completion;
+        }
+    );
+
+    return lua_yield(T, 0);
+}
+
+void EventLoop::spawn(lua_State* T, lua_State* from, int nargs)
+{
+    // anchored by the stack of from for as long as the first resume runs
+    Wakeup wakeup;
+    wakeup.thread = T;
+    wakeup.nargs = nargs;
+
+    resume(wakeup, from);
+}
+
+void EventLoop::setFinishHook(lua_State* T, std::function<void(lua_State* T, int status)> onFinish)
+{
+    finishHooks[T] = std::move(onFinish);
+}
+
+bool EventLoop::isSuspended(lua_State* T) const
+{
+    return suspended.count(T) != 0;
+}
+
+bool EventLoop::hasPending() const
+{
+    return !ready.empty() || !timers.empty() || inflight != 0;
+}
+
+bool EventLoop::isIdle() const
+{
+    return !hasPending() && suspended.empty() && finishHooks.empty();
+}
+
+int EventLoop::run(lua_State* main, int status)
+{
+    mainThread = main;
+    mainStatus = status;
+
+    for (;;)
+    {
+        // threads resumed here can queue more; they all run before the loop blocks again
+        while (!ready.empty())
+        {
+            Wakeup wakeup = ready.front();
+            ready.pop_front();
+            resume(wakeup, nullptr);
+        }
+
+        if (timers.empty() && inflight == 0)
+            break;
+
+        if (!waitForEvents())
+            break;
+    }
+
+    mainThread = nullptr;
+    return mainStatus;
+}
+
+bool EventLoop::isValid() const
+{
+#ifdef __linux__
+    return epollFd >= 0 && timerFd >= 0 && eventFd >= 0;
+#else
+    return true;
+#endif
+}
+
+void EventLoop::resume(Wakeup wakeup, lua_State* from)
+{
+    lua_State* T = wakeup.thread;
+    suspended.erase(T);
+
+    int nargs = wakeup.nargs;
+    if (wakeup.waitStart)
+    {
+        lua_pushnumber(T, double(monotonicNow() - wakeup.waitStart) / 1e9);
+        nargs = 1;
+    }
+
+    int status = lua_resume(T, from, nargs);
+
+    // a thread that yields to the loop again holds a reference of its own by now; any other yield leaves it
+    // suspended until something else resumes it, like coroutine.yield does
+    if (status != LUA_YIELD)
+        finish(T, status);
+    else if (T == mainThread)
+        mainStatus = status;
+
+    if (wakeup.ref != LUA_NOREF)
+        lua_unref(T, wakeup.ref);
+}
+
+void EventLoop::finish(lua_State* T, int status)
+{
+    auto hook = finishHooks.find(T);
+    if (hook != finishHooks.end())
+    {
+        std::function<void(lua_State*, int)> onFinish = std::move(hook->second);
+        finishHooks.erase(hook);
+        onFinish(T, status);
+        return;
+    }
+
+    if (T == mainThread)
+    {
+        mainStatus = status;
+        return;
+    }
+
+    if (status != LUA_OK)
+    {
+        const char* str = lua_tostring(T, -1);
+        std::string error = str ? str : "unknown error";
+        error += "\n";
+        error += lua_debugtrace(T);
+
+        // the output buffer of the run, if any, is where print writes too
+        reportTo(static_cast<std::string*>(lua_getthreaddata(lua_mainthread(T))), "❌ " + error);
+    }
+}
+
+void EventLoop::addTimer(uint64_t deadline, Wakeup wakeup)
+{
+    timers.push({deadline, nextSequence++, wakeup});
+
+    if (armedDeadline == 0 || deadline < armedDeadline)
+        armTimer();
+}
+
+void EventLoop::armTimer()
+{
+    armedDeadline = timers.empty() ? 0 : timers.top().deadline;
+
+#ifdef __linux__
+    itimerspec spec = {};
+
+    // a zero it_value disarms the timer
+    spec.it_value.tv_sec = time_t(armedDeadline / 1000000000);
+    spec.it_value.tv_nsec = long(armedDeadline % 1000000000);
+
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+#endif
+}
+
+void EventLoop::fireTimers()
+{
+#ifdef __linux__
+    // clears the readiness; the heap says what is due
+    uint64_t expirations = 0;
+    ssize_t length = ::read(timerFd, &expirations, sizeof(expirations));
+    (void)length;
+#endif
+
+    uint64_t now = monotonicNow();
+
+    while (!timers.empty() && timers.top().deadline <= now)
+    {
+        ready.push_back(timers.top().wakeup);
+        timers.pop();
+    }
+
+    armTimer();
+}
+
+void EventLoop::submit(Wakeup wakeup, std::function<Completion()> work)
+{
+    if (!io)
+        io = std::make_unique<TaskScheduler>(kIoThreads);
+
+    inflight++;
+
+    io->push(
+        [this, wakeup, work = std::move(work)]
+        {
+            Completion completion = work();
+            completion.wakeup = wakeup;
+
+            {
+                std::unique_lock guard(completionsMutex);
+                completions.push_back(std::move(completion));
+            }
+
+#ifdef __linux__
+            uint64_t one = 1;
+            ssize_t written = ::write(eventFd, &one, sizeof(one));
+            (void)written;
+#else
+            completionsReady.notify_one();
+#endif
+        }
+    );
+}
+
+void EventLoop::drainCompletions()
+{
+#ifdef __linux__
+    uint64_t count = 0;
+    if (::read(eventFd, &count, sizeof(count)) < 0)
+        return;
+#endif
+
+    std::vector<Completion> finished;
+    {
+        std::unique_lock guard(completionsMutex);
+        finished.swap(completions);
+    }
+
+    for (Completion& completion : finished)
+    {
+        lua_State* T = completion.wakeup.thread;
+
+        if (!completion.success)
+        {
+            lua_pushnil(T);
+            lua_pushlstring(T, completion.value.data(), completion.value.size());
+            completion.wakeup.nargs = 2;
+        }
+        else if (completion.isRead)
+        {
+            lua_pushlstring(T, completion.value.data(), completion.value.size());
+            completion.wakeup.nargs = 1;
+        }
+        else
+        {
+            lua_pushboolean(T, true);
+            completion.wakeup.nargs = 1;
+        }
+
+        ready.push_back(completion.wakeup);
+        inflight--;
+    }
+}
+
+bool EventLoop::waitForEvents()
+{
+#ifdef __linux__
+    epoll_event events[2];
+    int count = epoll_wait(epollFd, events, 2, -1);
+
+    if (count < 0 && errno != EINTR)
+    {
+        perror("epoll_wait");
+        return false;
+    }
+#else
+    {
+        std::unique_lock guard(completionsMutex);
+
+        auto finished = [this]
+        {
+            return !completions.empty();
+        };
+
+        if (armedDeadline == 0)
+        {
+            completionsReady.wait(guard, finished);
+        }
+        else
+        {
+            uint64_t now = monotonicNow();
+            completionsReady.wait_for(guard, std::chrono::nanoseconds(armedDeadline > now ? armedDeadline - now : 0), finished);
+        }
+    }
+#endif
+
+    // both are cheap to check, and whichever fired may not be the only one that is ready
+    fireTimers();
+    drainCompletions();
+    return true;
+}
+
+static int task_wait(lua_State* L)
+{
+    double seconds = luaL_optnumber(L, 1, 0);
+
+    if (!lua_isyieldable(L))
+        luaL_error(L, "task.wait can not yield here");
+
+    return EventLoop::get(L)->sleep(L, seconds);
+}
+
+// Creates a thread that calls the function at index first with the values after it as arguments, leaving the
+// thread on top of L and the argument count in nargs
+static lua_State* newTask(lua_State* L, int first, int& nargs)
+{
+    luaL_checktype(L, first, LUA_TFUNCTION);
+
+    int top = lua_gettop(L);
+    lua_State* T = lua_newthread(L);
+
+    for (int i = first; i <= top; i++)
+        lua_pushvalue(L, i);
+
+    lua_xmove(L, T, top - first + 1);
+
+    nargs = top - first;
+    return T;
+}
+
+static int task_delay(lua_State* L)
+{
+    double seconds = luaL_checknumber(L, 1);
+
+    int nargs = 0;
+    lua_State* T = newTask(L, 2, nargs);
+
+    EventLoop::get(L)->schedule(T, nargs, seconds);
+    return 1;
+}
+
+static int task_defer(lua_State* L)
+{
+    int nargs = 0;
+    lua_State* T = newTask(L, 1, nargs);
+
+    EventLoop::get(L)->schedule(T, nargs, 0);
+    return 1;
+}
+
+static int task_spawn(lua_State* L)
+{
+    int nargs = 0;
+    lua_State* T = newTask(L, 1, nargs);
+
+    EventLoop::get(L)->spawn(T, L, nargs);
+    return 1;
+}
+
+static int fs_readFile(lua_State* L)
+{
+    std::string path = luaL_checkstring(L, 1);
+
+    if (!lua_isyieldable(L))
+        luaL_error(L, "fs.readFile can not yield here");
+
+    return EventLoop::get(L)->readFile(L, std::move(path));
+}
+
+static int fs_writeFile(lua_State* L)
+{
+    std::string path = luaL_checkstring(L, 1);
+
+    size_t length = 0;
+    const char* contents = luaL_checklstring(L, 2, &length);
+
+    if (!lua_isyieldable(L))
+        luaL_error(L, "fs.writeFile can not yield here");
+
+    return EventLoop::get(L)->writeFile(L, std::move(path), std::string(contents, length));
+}
+
+const char* const kEventLoopDefinitions = R"(
+declare task: {
+    wait: (seconds: number?) -> number,
+    delay: (seconds: number, f: (...any) -> ...any, ...any) -> thread,
+    defer: (f: (...any) -> ...any, ...any) -> thread,
+    spawn: (f: (...any) -> ...any, ...any) -> thread,
+}
+
+declare fs: {
+    readFile: (path: string) -> (string?, string?),
+    writeFile: (path: string, contents: string) -> (boolean?, string?),
+}
+)";
+
+void openEventLoopLibraries(lua_State* L)
+{
+    static const luaL_Reg taskFuncs[] = {
+        {"wait", task_wait},
+        {"delay", task_delay},
+        {"defer", task_defer},
+        {"spawn", task_spawn},
+        {NULL, NULL},
+    };
+
+    static const luaL_Reg fsFuncs[] = {
+        {"readFile", fs_readFile},
+        {"writeFile", fs_writeFile},
+        {NULL, NULL},
+    };
+
+    luaL_register(L, "task", taskFuncs);
+    lua_pop(L, 1);
+
+    luaL_register(L, "fs", fsFuncs);
+    lua_pop(L, 1);
+}
+
+}
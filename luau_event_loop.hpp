@@ -0,0 +1,147 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "lua.h"
+
+namespace LuauUtils
+{
+    class TaskScheduler;
+
+    // Scheduler for the threads of one state that wait on timers and file I/O. Waiting threads are anchored in the
+    // registry and resumed in order from a ready queue. Timers live in a heap behind a single timerfd, finished I/O
+    // from a small worker pool is signalled through an eventfd, and both are waited on with epoll, so a waiting thread
+    // costs one heap or queue entry and no OS thread. Without epoll, the loop waits on a condition variable that
+    // finished I/O notifies, with the earliest timer as its deadline.
+    class EventLoop
+    {
+    public:
+        // A thread suspended on the loop; it is resumed with the nargs values on top of its stack
+        struct Wakeup
+        {
+            lua_State* thread = nullptr;
+            int ref = LUA_NOREF;
+            int nargs = 0;
+            // for task.wait, which resumes with the time it waited; 0 otherwise
+            uint64_t waitStart = 0;
+        };
+
+        EventLoop();
+        ~EventLoop();
+
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        // The loop of a state from createState, created on first use; raises a Lua error when it can't be set up
+        static EventLoop* get(lua_State* L);
+
+        // Anchors T, which must yield right after, until wake is called with the result
+        Wakeup suspend(lua_State* T);
+        void wake(Wakeup wakeup, int nargs);
+
+        // Resumes T with the top nargs values of its stack after seconds, or on the next turn of the loop when
+        // seconds is not positive. T is either suspended or a new thread with a function below its arguments.
+        void schedule(lua_State* T, int nargs, double seconds);
+
+        // The bodies of task.wait, fs.readFile and fs.writeFile: suspend T and return lua_yield
+        int sleep(lua_State* T, double seconds);
+        int readFile(lua_State* T, std::string path);
+        int writeFile(lua_State* T, std::string path, std::string contents);
+
+        // Resumes T now, from the thread from, with the loop's handling of yields and errors
+        void spawn(lua_State* T, lua_State* from, int nargs);
+
+        // Calls onFinish with T's status once it stops without yielding, instead of reporting its errors
+        void setFinishHook(lua_State* T, std::function<void(lua_State* T, int status)> onFinish);
+
+        bool isSuspended(lua_State* T) const;
+        bool hasPending() const;
+
+        // True when no thread is queued, sleeping, suspended or waiting on a finish hook
+        bool isIdle() const;
+
+        // Runs until no thread waits on anything. main is the script thread its caller resumed, which returned status;
+        // its final status is returned and its error, if any, is left on its stack for the caller to report.
+        int run(lua_State* main, int status);
+
+    private:
+        struct Timer
+        {
+            uint64_t deadline;
+            uint64_t sequence;
+            Wakeup wakeup;
+
+            bool operator>(const Timer& other) const
+            {
+                return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+            }
+        };
+
+        struct Completion
+        {
+            Wakeup wakeup;
+            bool success = false;
+            // successful reads resume with the file contents, writes with true
+            bool isRead = false;
+            // the file contents, or the error message on failure
+            std::string value;
+        };
+
+        bool isValid() const;
+
+        void resume(Wakeup wakeup, lua_State* from);
+        void finish(lua_State* T, int status);
+
+        void addTimer(uint64_t deadline, Wakeup wakeup);
+        void armTimer();
+        void fireTimers();
+
+        void submit(Wakeup wakeup, std::function<Completion()> work);
+        void drainCompletions();
+        bool waitForEvents();
+
+#ifdef __linux__
+        int epollFd = -1;
+        int timerFd = -1;
+        int eventFd = -1;
+#endif
+        // deadline timerFd is set to, 0 when disarmed
+        uint64_t armedDeadline = 0;
+
+        std::deque<Wakeup> ready;
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+        uint64_t nextSequence = 0;
+
+        std::unordered_set<lua_State*> suspended;
+        std::unordered_map<lua_State*, std::function<void(lua_State*, int)>> finishHooks;
+
+        lua_State* mainThread = nullptr;
+        int mainStatus = LUA_OK;
+
+        size_t inflight = 0;
+        std::mutex completionsMutex;
+        std::vector<Completion> completions;
+#ifndef __linux__
+        std::condition_variable completionsReady;
+#endif
+
+        // created with the first file operation and joined first on destruction, since its tasks complete into the above
+        std::unique_ptr<TaskScheduler> io;
+    };
+
+    // Registers the task library (wait, delay, spawn, defer) and the fs library (readFile, writeFile)
+    void openEventLoopLibraries(lua_State* L);
+
+    // Type definitions of the libraries above, for analysis
+    extern const char* const kEventLoopDefinitions;
+}
@@ -0,0 +1,299 @@
+#include "luau_gc.hpp"
+#include "luau_runtime.hpp"
+#include "luau_trace.hpp"
+
+#include "lualib.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace LuauUtils {
+
+namespace {
+
+GcMonitor* monitorOf(lua_State* L)
+{
+    StateData* data = getStateData(L);
+    return data ? &data->gc : nullptr;
+}
+
+int setParameter(lua_State* L, int op, int value)
+{
+    int previous = lua_gc(L, op, value);
+
+    if (GcMonitor* monitor = monitorOf(L))
+        monitor->rememberTuning(op, previous);
+
+    return previous;
+}
+
+}
+
+std::optional<double> GcMonitor::onGcInterrupt(int phase)
+{
+    double now = lua_clock();
+
+    if (!inStep)
+    {
+        inStep = true;
+        stepStart = now;
+        return std::nullopt;
+    }
+
+    inStep = false;
+    double seconds = now - stepStart;
+
+    stats.steps++;
+
+    if (phase >= 0 && phase < GcStats::kMaxPhases)
+        stats.phaseSeconds[phase] += seconds;
+
+    // steps go through the phases in order, so starting in an earlier phase than last time means a cycle completed
+    if (phase < lastPhase)
+        stats.cycles++;
+
+    lastPhase = phase;
+    recordPause(seconds);
+
+    return seconds;
+}
+
+void GcMonitor::beginHostWork()
+{
+    hostWorkStart = lua_clock();
+}
+
+void GcMonitor::endFullCollection()
+{
+    double seconds = lua_clock() - hostWorkStart;
+
+    stats.fullCollections++;
+    stats.cycles++;
+    stats.fullCollectionSeconds += seconds;
+    recordPause(seconds);
+
+    // the collector is back at the start of a cycle
+    lastPhase = -1;
+}
+
+void GcMonitor::rememberTuning(int op, int previous)
+{
+    Tuning* tuning = op == LUA_GCSETGOAL ? &goal : op == LUA_GCSETSTEPMUL ? &stepMul : op == LUA_GCSETSTEPSIZE ? &stepSize : nullptr;
+
+    if (tuning && !tuning->changed)
+    {
+        tuning->changed = true;
+        tuning->value = previous;
+    }
+}
+
+void GcMonitor::setStopped(bool value)
+{
+    stopped = value;
+}
+
+void GcMonitor::resetTuning(lua_State* L)
+{
+    if (goal.changed)
+        lua_gc(L, LUA_GCSETGOAL, goal.value);
+    if (stepMul.changed)
+        lua_gc(L, LUA_GCSETSTEPMUL, stepMul.value);
+    if (stepSize.changed)
+        lua_gc(L, LUA_GCSETSTEPSIZE, stepSize.value);
+    if (stopped)
+        lua_gc(L, LUA_GCRESTART, 0);
+
+    goal = {};
+    stepMul = {};
+    stepSize = {};
+    stopped = false;
+}
+
+const GcStats& GcMonitor::getStats() const
+{
+    return stats;
+}
+
+void GcMonitor::resetStats()
+{
+    stats = {};
+    inStep = false;
+    lastPhase = -1;
+}
+
+void GcMonitor::recordPause(double seconds)
+{
+    stats.pauses++;
+    stats.pauseSeconds += seconds;
+    stats.maxPauseSeconds = std::max(stats.maxPauseSeconds, seconds);
+
+    int bucket = 0;
+    for (double limit = 1e-5; bucket < GcStats::kPauseBuckets - 1 && seconds >= limit; limit *= 10)
+        bucket++;
+
+    stats.pauseHistogram[bucket]++;
+}
+
+bool gcStep(lua_State* L, int kilobytes)
+{
+    // the steps themselves are recorded by the GC interrupt
+    return lua_gc(L, LUA_GCSTEP, kilobytes) != 0;
+}
+
+void gcCollect(lua_State* L)
+{
+    TraceSpan span("gc", "full collection");
+
+    GcMonitor* monitor = monitorOf(L);
+    if (monitor)
+        monitor->beginHostWork();
+
+    lua_gc(L, LUA_GCCOLLECT, 0);
+
+    if (monitor)
+        monitor->endFullCollection();
+}
+
+void gcStop(lua_State* L)
+{
+    lua_gc(L, LUA_GCSTOP, 0);
+
+    if (GcMonitor* monitor = monitorOf(L))
+        monitor->setStopped(true);
+}
+
+void gcRestart(lua_State* L)
+{
+    lua_gc(L, LUA_GCRESTART, 0);
+
+    if (GcMonitor* monitor = monitorOf(L))
+        monitor->setStopped(false);
+}
+
+int gcSetGoal(lua_State* L, int percent)
+{
+    return setParameter(L, LUA_GCSETGOAL, percent);
+}
+
+int gcSetStepMul(lua_State* L, int percent)
+{
+    return setParameter(L, LUA_GCSETSTEPMUL, percent);
+}
+
+int gcSetStepSize(lua_State* L, int kilobytes)
+{
+    return setParameter(L, LUA_GCSETSTEPSIZE, kilobytes);
+}
+
+std::string formatGcStats(const GcStats& stats)
+{
+    char buffer[256];
+    std::string result;
+
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "gc: %llu cycles (%llu full), %llu steps, %llu pauses totalling %.3f ms, max %.3f ms\n",
+        (unsigned long long)stats.cycles,
+        (unsigned long long)stats.fullCollections,
+        (unsigned long long)stats.steps,
+        (unsigned long long)stats.pauses,
+        stats.pauseSeconds * 1000,
+        stats.maxPauseSeconds * 1000
+    );
+    result += buffer;
+
+    result += "gc phases:";
+    for (int phase = 0; phase < GcStats::kMaxPhases; phase++)
+    {
+        if (stats.phaseSeconds[phase] > 0.0)
+        {
+            snprintf(buffer, sizeof(buffer), " %s %.3f ms", lua_gcstatename(phase), stats.phaseSeconds[phase] * 1000);
+            result += buffer;
+        }
+    }
+    if (stats.fullCollections)
+    {
+        snprintf(buffer, sizeof(buffer), " full %.3f ms", stats.fullCollectionSeconds * 1000);
+        result += buffer;
+    }
+    result += "\n";
+
+    static const char* const bucketNames[GcStats::kPauseBuckets] = {"<10us", "<100us", "<1ms", "<10ms", ">=10ms"};
+
+    result += "gc pauses:";
+    for (int bucket = 0; bucket < GcStats::kPauseBuckets; bucket++)
+    {
+        snprintf(buffer, sizeof(buffer), " %s %llu", bucketNames[bucket], (unsigned long long)stats.pauseHistogram[bucket]);
+        result += buffer;
+    }
+    result += "\n";
+
+    return result;
+}
+
+int collectgarbage(lua_State* L)
+{
+    const char* option = luaL_optstring(L, 1, "collect");
+
+    if (strcmp(option, "collect") == 0)
+    {
+        gcCollect(L);
+        return 0;
+    }
+
+    if (strcmp(option, "count") == 0)
+    {
+        int c = lua_gc(L, LUA_GCCOUNT, 0);
+        lua_pushnumber(L, c);
+        return 1;
+    }
+
+    if (strcmp(option, "step") == 0)
+    {
+        lua_pushboolean(L, gcStep(L, luaL_optinteger(L, 2, 0)));
+        return 1;
+    }
+
+    if (strcmp(option, "stop") == 0)
+    {
+        gcStop(L);
+        return 0;
+    }
+
+    if (strcmp(option, "restart") == 0)
+    {
+        gcRestart(L);
+        return 0;
+    }
+
+    if (strcmp(option, "isrunning") == 0)
+    {
+        lua_pushboolean(L, lua_gc(L, LUA_GCISRUNNING, 0));
+        return 1;
+    }
+
+    if (strcmp(option, "setgoal") == 0)
+    {
+        lua_pushinteger(L, gcSetGoal(L, luaL_checkinteger(L, 2)));
+        return 1;
+    }
+
+    if (strcmp(option, "setstepmul") == 0)
+    {
+        lua_pushinteger(L, gcSetStepMul(L, luaL_checkinteger(L, 2)));
+        return 1;
+    }
+
+    if (strcmp(option, "setstepsize") == 0)
+    {
+        lua_pushinteger(L, gcSetStepSize(L, luaL_checkinteger(L, 2)));
+        return 1;
+    }
+
+    luaL_error(L, "collectgarbage must be called with 'count', 'collect', 'step', 'stop', 'restart', 'isrunning', 'setgoal', "
+                  "'setstepmul' or 'setstepsize'");
+}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "lua.h"
+
+namespace LuauUtils
+{
+    // GC activity of a state during a run
+    struct GcStats
+    {
+        // GC phases are numbered like the state passed to the interrupt callback; see lua_gcstatename
+        static constexpr int kMaxPhases = 8;
+        // pauses under 10us, 100us, 1ms, 10ms and longer
+        static constexpr int kPauseBuckets = 5;
+
+        uint64_t cycles = 0;
+        uint64_t steps = 0;
+        uint64_t fullCollections = 0;
+
+        double phaseSeconds[kMaxPhases] = {};
+        double fullCollectionSeconds = 0.0;
+
+        uint64_t pauses = 0;
+        double pauseSeconds = 0.0;
+        double maxPauseSeconds = 0.0;
+        uint64_t pauseHistogram[kPauseBuckets] = {};
+    };
+
+    // Per-state GC bookkeeping. The VM raises the GC interrupt right before and right after every incremental step,
+    // the second time with the phase the step started in, so steps are timed between the two; see createState.
+    class GcMonitor
+    {
+    public:
+        // returns how long the step took, in seconds, on the interrupt that ends a step
+        std::optional<double> onGcInterrupt(int phase);
+
+        // for work the host starts itself, which is timed directly
+        void beginHostWork();
+        void endFullCollection();
+
+        // records a parameter's value before the first change so that resetTuning can restore it
+        void rememberTuning(int op, int previous);
+        void setStopped(bool value);
+        // restores tuning changed since the state was created and restarts a stopped collector
+        void resetTuning(lua_State* L);
+
+        const GcStats& getStats() const;
+        void resetStats();
+
+    private:
+        void recordPause(double seconds);
+
+        GcStats stats;
+        double stepStart = 0.0;
+        bool inStep = false;
+        double hostWorkStart = 0.0;
+        int lastPhase = -1;
+
+        struct Tuning
+        {
+            bool changed = false;
+            int value = 0;
+        };
+
+        Tuning goal;
+        Tuning stepMul;
+        Tuning stepSize;
+        bool stopped = false;
+    };
+
+    // Host-side GC control; these go through the state's GcMonitor so that pooled states can be reset afterwards
+    // and explicit work shows up in the stats. Setters return the previous value.
+    bool gcStep(lua_State* L, int kilobytes);
+    void gcCollect(lua_State* L);
+    void gcStop(lua_State* L);
+    void gcRestart(lua_State* L);
+    int gcSetGoal(lua_State* L, int percent);
+    int gcSetStepMul(lua_State* L, int percent);
+    int gcSetStepSize(lua_State* L, int kilobytes);
+
+    // a few lines summarizing stats, for the end of a run
+    std::string formatGcStats(const GcStats& stats);
+
+    // collectgarbage([option [, arg]]) with "collect", "count", "step", "stop", "restart", "isrunning", "setgoal",
+    // "setstepmul" and "setstepsize"
+    int collectgarbage(lua_State* L);
+}
@@ -0,0 +1,58 @@
+#include "luau_pipeline.hpp"
+#include "luau_analyzer.hpp"
+#include "luau_preload.hpp"
+#include "luau_runtime.hpp"
+
+#include <atomic>
+#include <future>
+
+namespace LuauUtils {
+
+bool runPipelined(const std::string& scriptFilePath, std::string_view script)
+{
+    std::atomic<bool> cancelled{false};
+
+    std::future<bool> analysis = std::async(
+        std::launch::async,
+        [&]
+        {
+            AnalyzeOptions analyzeOptions;
+            analyzeOptions.sources[scriptFilePath] = script;
+
+            bool passed = analyzeLuau({scriptFilePath}, analyzeOptions);
+            if (!passed)
+                cancelled.store(true, std::memory_order_relaxed);
+            return passed;
+        }
+    );
+
+    if (!precompiledChunks)
+        precompiledChunks = std::make_unique<PrecompiledChunks>();
+
+    // load errors are held back so that they don't interleave with analysis output, or show up when nothing runs
+    std::string loadOutput;
+
+    lua_State* L = createState();
+    int status = L ? loadScript(L, script, /* sandboxed= */ false, "=script", &loadOutput) : LUA_ERRMEM;
+
+    if (status == LUA_OK && globalOptions.preload)
+        preloadRequireGraph(scriptFilePath, script, *precompiledChunks, 0, &cancelled);
+
+    bool passed = analysis.get();
+
+    if (passed)
+    {
+        fwrite(loadOutput.data(), 1, loadOutput.size(), stdout);
+
+        if (status == LUA_OK)
+            resumeScript(L);
+    }
+
+    DEBUG_LOG("Cleaning up...");
+    if (L)
+        closeState(L);
+
+    return passed;
+}
+
+}
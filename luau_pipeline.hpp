@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace LuauUtils
+{
+    // Analyzes scriptFilePath on a background thread while the entry chunk is compiled and loaded and the modules it
+    // statically requires are compiled ahead of time in parallel. The script runs once analysis passes; when analysis
+    // fails, precompilation stops starting new modules, the loaded state is closed without running and false is
+    // returned.
+    bool runPipelined(const std::string& scriptFilePath, std::string_view script);
+}
@@ -0,0 +1,45 @@
+#include "luau_precompiled.hpp"
+#include "luau_utils.hpp"
+
+namespace LuauUtils {
+
+PrecompiledChunks::SourceKey PrecompiledChunks::SourceKey::of(std::string_view source)
+{
+    SourceKey key;
+    key.hash = hashBytes(source.data(), source.size());
+    key.check = hashBytes(source.data(), source.size(), 0x9e3779b97f4a7c15ull);
+    key.size = source.size();
+    return key;
+}
+
+void PrecompiledChunks::add(const SourceKey& key, std::string bytecode)
+{
+    std::unique_lock guard(mtx);
+    entries.emplace(key, std::move(bytecode));
+}
+
+void PrecompiledChunks::add(std::string_view source, std::string bytecode)
+{
+    add(SourceKey::of(source), std::move(bytecode));
+}
+
+std::optional<std::string> PrecompiledChunks::find(std::string_view source) const
+{
+    SourceKey key = SourceKey::of(source);
+
+    std::unique_lock guard(mtx);
+
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return std::nullopt;
+
+    return it->second;
+}
+
+size_t PrecompiledChunks::size() const
+{
+    std::unique_lock guard(mtx);
+    return entries.size();
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace LuauUtils
+{
+    // Bytecode compiled ahead of execution, looked up by source contents so that it doesn't matter whether a module
+    // is named by its analysis or its runtime path. compileSource serves chunks from here before compiling.
+    class PrecompiledChunks
+    {
+    public:
+        // Identifies a source by two independent 64-bit hashes and its size, so sources don't have to be kept around
+        struct SourceKey
+        {
+            uint64_t hash = 0;
+            uint64_t check = 0;
+            size_t size = 0;
+
+            static SourceKey of(std::string_view source);
+
+            bool operator==(const SourceKey& other) const
+            {
+                return hash == other.hash && check == other.check && size == other.size;
+            }
+        };
+
+        void add(const SourceKey& key, std::string bytecode);
+        void add(std::string_view source, std::string bytecode);
+        std::optional<std::string> find(std::string_view source) const;
+
+        size_t size() const;
+
+    private:
+        struct KeyHash
+        {
+            size_t operator()(const SourceKey& key) const
+            {
+                return size_t(key.hash);
+            }
+        };
+
+        mutable std::mutex mtx;
+        std::unordered_map<SourceKey, std::string, KeyHash> entries;
+    };
+}
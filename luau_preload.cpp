@@ -0,0 +1,167 @@
+#include "luau_preload.hpp"
+#include "luau_runtime.hpp"
+#include "luau_source.hpp"
+#include "luau_trace.hpp"
+#include "luau_utils.hpp"
+#include "Luau/Ast.h"
+#include "Luau/BytecodeBuilder.h"
+#include "Luau/Compiler.h"
+#include "Luau/Parser.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+namespace LuauUtils {
+
+namespace {
+
+struct RequireCollector : Luau::AstVisitor
+{
+    std::vector<Luau::AstExpr*> arguments;
+
+    bool visit(Luau::AstExprCall* call) override
+    {
+        if (Luau::AstExprGlobal* global = call->func->as<Luau::AstExprGlobal>(); global && global->name == "require" && call->args.size == 1)
+            arguments.push_back(call->args.data[0]);
+
+        return true;
+    }
+};
+
+class GraphPreloader
+{
+public:
+    GraphPreloader(PrecompiledChunks& chunks, unsigned threadCount, const std::atomic<bool>* cancelled)
+        : chunks(chunks)
+        , cancelled(cancelled)
+        , scheduler(threadCount)
+    {
+    }
+
+    size_t run(const std::string& entryPath, std::string_view entrySource)
+    {
+        seen.insert(entryPath);
+
+        // the entry is only scanned for requires, so it is done here while the workers start up
+        visit(entryPath, entrySource, /* compile= */ false);
+
+        std::unique_lock guard(mtx);
+        cv.wait(
+            guard,
+            [this]
+            {
+                return pending == 0;
+            }
+        );
+
+        return compiled;
+    }
+
+private:
+    void schedule(const std::string& name)
+    {
+        {
+            std::unique_lock guard(mtx);
+            if (!seen.insert(name).second)
+                return;
+
+            pending++;
+        }
+
+        scheduler.push(
+            [this, name]
+            {
+                if (!cancelled || !cancelled->load(std::memory_order_relaxed))
+                {
+                    if (std::optional<SourceFile> file = SourceFile::open(name))
+                        visit(name, file->view(), /* compile= */ true);
+                }
+
+                std::unique_lock guard(mtx);
+                if (--pending == 0)
+                    cv.notify_all();
+            }
+        );
+    }
+
+    void visit(const std::string& name, std::string_view source, bool compile)
+    {
+        Luau::Allocator allocator;
+        Luau::AstNameTable names(allocator);
+        Luau::ParseResult result = Luau::Parser::parse(source.data(), source.size(), names, allocator, Luau::ParseOptions());
+
+        // dependencies go out to other workers before this module is compiled
+        Luau::ModuleInfo context{name};
+
+        for (Luau::AstExpr* expr : collectRequireArguments(result.root))
+        {
+            if (std::optional<Luau::ModuleInfo> info = fileResolver.resolveModule(&context, expr))
+                schedule(info->name);
+        }
+
+        if (!compile || !result.errors.empty())
+            return;
+
+        // with a bytecode cache, a module compiled by an earlier run is read from it instead
+        if (bytecodeCache)
+        {
+            chunks.add(source, compileSource(source));
+        }
+        else
+        {
+            try
+            {
+                TraceSpan span("compile", "compile", name);
+
+                Luau::BytecodeBuilder bcb;
+                Luau::compileOrThrow(bcb, result, names, copts());
+                chunks.add(source, bcb.getBytecode());
+            }
+            catch (const Luau::CompileError&)
+            {
+                return;
+            }
+        }
+
+        std::unique_lock guard(mtx);
+        compiled++;
+    }
+
+    PrecompiledChunks& chunks;
+    const std::atomic<bool>* cancelled;
+
+    // resolveModule keeps no state between calls, so workers share one
+    FileResolver fileResolver;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::unordered_set<std::string> seen;
+    size_t pending = 0;
+    size_t compiled = 0;
+
+    // last, so that its workers are joined before anything they use is destroyed
+    TaskScheduler scheduler;
+};
+
+}
+
+std::vector<Luau::AstExpr*> collectRequireArguments(Luau::AstStatBlock* root)
+{
+    RequireCollector collector;
+    root->visit(&collector);
+    return std::move(collector.arguments);
+}
+
+size_t preloadRequireGraph(
+    const std::string& entryPath, std::string_view entrySource, PrecompiledChunks& chunks, unsigned threadCount,
+    const std::atomic<bool>* cancelled
+)
+{
+    GraphPreloader preloader(chunks, threadCount ? threadCount : TaskScheduler::getThreadCount(), cancelled);
+    return preloader.run(entryPath, entrySource);
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Luau/Ast.h"
+
+#include "luau_precompiled.hpp"
+
+namespace LuauUtils
+{
+    // The argument of every require call with a single argument in root, like the Frontend's require tracer finds
+    std::vector<Luau::AstExpr*> collectRequireArguments(Luau::AstStatBlock* root);
+
+    // Finds every module entryPath statically requires, directly or through other modules, and compiles them into
+    // chunks on a TaskScheduler with threadCount workers (0 for one per core), so that lua_require only has to load
+    // them. Each module is parsed once, for both its requires and its bytecode. The entry chunk itself is not
+    // compiled. Dynamic requires and modules with syntax errors are left for lua_require, which reports the errors.
+    // Stops starting new modules once cancelled is set. Returns the number of modules compiled.
+    size_t preloadRequireGraph(
+        const std::string& entryPath, std::string_view entrySource, PrecompiledChunks& chunks, unsigned threadCount = 0,
+        const std::atomic<bool>* cancelled = nullptr
+    );
+}
@@ -0,0 +1,244 @@
+#include "luau_profiler.hpp"
+#include "luau_runtime.hpp"
+#include "luau_trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+namespace LuauUtils {
+
+std::atomic<int> Profiler::started{0};
+
+Profiler::Profiler(unsigned frequency)
+    : frequency(std::max(frequency, 1u))
+{
+}
+
+Profiler::~Profiler()
+{
+    stop();
+}
+
+void Profiler::start(lua_State* L)
+{
+    state = L;
+
+    StateData* data = getStateData(L);
+    data->profiler = this;
+    lua_callbacks(L)->interrupt = stateInterrupt;
+    started.fetch_add(1, std::memory_order_relaxed);
+
+    exiting = false;
+    timer = std::thread(
+        [this]
+        {
+            timerLoop();
+        }
+    );
+}
+
+void Profiler::stop()
+{
+    if (!timer.joinable())
+        return;
+
+    {
+        std::unique_lock guard(mtx);
+        exiting = true;
+    }
+
+    cv.notify_one();
+    timer.join();
+
+    // the interrupt stays installed when GC stats or trace spans need it
+    getStateData(state)->profiler = nullptr;
+    started.fetch_sub(1, std::memory_order_relaxed);
+    if (!globalOptions.gcStats && !traceEnabled())
+        lua_callbacks(state)->interrupt = nullptr;
+}
+
+bool Profiler::anyStarted()
+{
+    return started.load(std::memory_order_relaxed) != 0;
+}
+
+void Profiler::timerLoop()
+{
+    using Clock = std::chrono::steady_clock;
+
+    Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / frequency));
+    Clock::time_point last = Clock::now();
+    Clock::time_point next = last + period;
+
+    std::unique_lock guard(mtx);
+
+    while (!cv.wait_until(
+        guard,
+        next,
+        [this]
+        {
+            return exiting;
+        }
+    ))
+    {
+        Clock::time_point now = Clock::now();
+        ticks.fetch_add(uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(now - last).count()), std::memory_order_relaxed);
+
+        last = now;
+        // a late wakeup is absorbed by the tick count rather than by sampling more often to catch up
+        next = std::max(next + period, now);
+    }
+}
+
+void Profiler::onInterrupt(lua_State* L, int gc)
+{
+    uint64_t current = ticks.load(std::memory_order_relaxed);
+    if (current == sampledTicks)
+        return;
+
+    uint64_t elapsed = current - sampledTicks;
+    sampledTicks = current;
+    samples++;
+
+    scratch.clear();
+
+    // a thread running a module was resumed by require, whose caller is suspended in an outer thread
+    for (lua_State* outer : getStateData(L)->requireChain)
+    {
+        if (outer != L)
+            appendFrames(outer);
+    }
+
+    appendFrames(L);
+
+    if (gc >= 0)
+    {
+        if (!scratch.empty())
+            scratch += ';';
+        scratch += "GC ";
+        scratch += lua_gcstatename(gc);
+    }
+
+    stacks[scratch] += elapsed;
+}
+
+void Profiler::appendFrames(lua_State* L)
+{
+    std::vector<std::string> frames;
+
+    lua_Debug ar;
+    for (int level = 0; lua_getinfo(L, level, "sn", &ar); level++)
+    {
+        std::string frame;
+
+        if (strcmp(ar.what, "main") == 0)
+            frame = "<main>";
+        else
+            frame = ar.name ? ar.name : "<anonymous>";
+
+        frame += ' ';
+
+        if (strcmp(ar.what, "C") == 0)
+        {
+            frame += "[C]";
+        }
+        else
+        {
+            frame += ar.short_src;
+            frame += ':';
+            frame += std::to_string(ar.linedefined);
+        }
+
+        // ';' separates frames in the folded format
+        std::replace(frame.begin(), frame.end(), ';', ',');
+        frames.push_back(std::move(frame));
+    }
+
+    for (auto it = frames.rbegin(); it != frames.rend(); ++it)
+    {
+        if (!scratch.empty())
+            scratch += ';';
+        scratch += *it;
+    }
+}
+
+uint64_t Profiler::getSampleCount() const
+{
+    return samples;
+}
+
+bool Profiler::writeFolded(const std::string& path) const
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+
+    std::vector<std::pair<std::string, uint64_t>> sorted(stacks.begin(), stacks.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    for (const auto& [stack, time] : sorted)
+        fprintf(file, "%s %llu\n", stack.c_str(), (unsigned long long)time);
+
+    return fclose(file) == 0;
+}
+
+void Profiler::reportFunctions(FILE* out, size_t limit) const
+{
+    struct FunctionTime
+    {
+        uint64_t self = 0;
+        uint64_t total = 0;
+    };
+
+    std::unordered_map<std::string, FunctionTime> functions;
+    uint64_t totalTime = 0;
+
+    for (const auto& [stack, time] : stacks)
+    {
+        totalTime += time;
+
+        // recursive functions count once towards their total per stack
+        std::unordered_set<std::string> seen;
+
+        size_t start = 0;
+        while (start <= stack.size())
+        {
+            size_t end = stack.find(';', start);
+            if (end == std::string::npos)
+                end = stack.size();
+
+            std::string frame = stack.substr(start, end - start);
+            if (end == stack.size())
+                functions[frame].self += time;
+            if (seen.insert(frame).second)
+                functions[frame].total += time;
+
+            start = end + 1;
+        }
+    }
+
+    std::vector<std::pair<std::string, FunctionTime>> sorted(functions.begin(), functions.end());
+    std::sort(
+        sorted.begin(),
+        sorted.end(),
+        [](const auto& a, const auto& b)
+        {
+            return a.second.self > b.second.self;
+        }
+    );
+
+    fprintf(out, "profile: %llu samples over %.3f ms\n", (unsigned long long)samples, totalTime / 1000.0);
+    fprintf(out, "%8s %8s  %s\n", "self", "total", "function");
+
+    for (size_t i = 0; i < sorted.size() && i < limit; i++)
+    {
+        const auto& [name, time] = sorted[i];
+        fprintf(out, "%7.2f%% %7.2f%%  %s\n", 100.0 * time.self / std::max<uint64_t>(totalTime, 1),
+            100.0 * time.total / std::max<uint64_t>(totalTime, 1), name.c_str());
+    }
+}
+
+}
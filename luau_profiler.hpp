@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "lua.h"
+
+namespace LuauUtils
+{
+    // Sampling profiler for a single state. A timer thread advances a tick counter at the sampling frequency and the
+    // VM interrupt, which runs on the thread executing Luau code, attributes the ticks since the last sample to the
+    // current call stack. Stacks continue through require, so module code shows up under the script that loaded it.
+    class Profiler
+    {
+    public:
+        static constexpr unsigned kDefaultFrequency = 1000;
+
+        explicit Profiler(unsigned frequency);
+        ~Profiler();
+
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+
+        // L must come from createState and must not be closed before stop
+        void start(lua_State* L);
+        void stop();
+
+        // called from the state's interrupt callback; gc is the GC phase for GC steps and -1 otherwise
+        void onInterrupt(lua_State* L, int gc);
+
+        uint64_t getSampleCount() const;
+
+        // Whether any state has a profiler started; lets the interrupt skip its state lookup on the hot path. Only
+        // meaningful from a thread that starts its own profilers, which is the only one that needs an exact answer.
+        static bool anyStarted();
+
+        // one "frame;frame;frame microseconds" line per distinct stack, outermost frame first, for flamegraph tools
+        bool writeFolded(const std::string& path) const;
+
+        // self and total time of the functions with the most self time
+        void reportFunctions(FILE* out, size_t limit) const;
+
+    private:
+        static std::atomic<int> started;
+
+        void timerLoop();
+        void appendFrames(lua_State* L);
+
+        unsigned frequency;
+        lua_State* state = nullptr;
+
+        std::thread timer;
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool exiting = false;
+
+        // microseconds of wall time the timer has seen, and how much of it has been attributed to a stack
+        std::atomic<uint64_t> ticks{0};
+        uint64_t sampledTicks = 0;
+        uint64_t samples = 0;
+
+        std::unordered_map<std::string, uint64_t> stacks;
+        std::string scratch;
+    };
+}
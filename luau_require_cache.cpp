@@ -0,0 +1,278 @@
+#include "luau_require_cache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Luau/Config.h"
+#include "Luau/FileUtils.h"
+
+namespace LuauUtils {
+
+std::optional<RequireCache::Resolution> RequireCache::find(const std::string& contextPath, const std::string& require)
+{
+    std::optional<std::string> absoluteContext = absoluteContextPath(contextPath);
+    if (!absoluteContext)
+        return std::nullopt;
+
+    std::string key = makeKey(*absoluteContext, require);
+
+    std::optional<Entry> entry;
+
+    {
+        std::shared_lock guard(mtx);
+
+        auto it = entries.find(key);
+        if (it != entries.end())
+            entry = it->second;
+    }
+
+    if (!entry)
+    {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    bool changed = std::any_of(
+        entry->dependencies.begin(),
+        entry->dependencies.end(),
+        [](const std::pair<std::string, FileStamp>& dependency)
+        {
+            return !(statPath(dependency.first) == dependency.second);
+        }
+    );
+
+    if (changed)
+    {
+        {
+            std::unique_lock guard(mtx);
+            entries.erase(key);
+        }
+
+        invalidations.fetch_add(1, std::memory_order_relaxed);
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return std::move(entry->resolution);
+}
+
+void RequireCache::add(const std::string& contextPath, const std::string& require, Resolution resolution)
+{
+    std::optional<std::string> absoluteContext = absoluteContextPath(contextPath);
+    if (!absoluteContext)
+        return;
+
+    Entry entry;
+
+    if (!resolution.stamp.exists)
+        return;
+
+    // the module's stamp was taken before its source was read; a missing .luaurc is recorded too, so that creating one
+    // invalidates the entry
+    for (std::string& path : dependencyPaths(*absoluteContext, require, resolution.absolutePath))
+    {
+        FileStamp stamp = path == resolution.absolutePath ? resolution.stamp : statPath(path);
+        entry.dependencies.emplace_back(std::move(path), stamp);
+    }
+
+    entry.resolution = std::move(resolution);
+
+    std::unique_lock guard(mtx);
+    entries[makeKey(*absoluteContext, require)] = std::move(entry);
+}
+
+std::optional<RequireCache::Resolution> RequireCache::readModule(std::string path, std::string absolutePath)
+{
+    int fd = open(absolutePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return std::nullopt;
+
+    Resolution resolution;
+    resolution.path = std::move(path);
+    resolution.absolutePath = std::move(absolutePath);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return std::nullopt;
+    }
+
+    resolution.stamp = stampOf(st);
+
+    std::string source;
+    source.resize(size_t(st.st_size));
+
+    size_t offset = 0;
+    for (;;)
+    {
+        // a file that grew since the stamp is read to the end; its stamp won't match anyway
+        if (offset == source.size())
+            source.resize(source.size() + 4096);
+
+        ssize_t length = read(fd, source.data() + offset, source.size() - offset);
+        if (length < 0 && errno == EINTR)
+            continue;
+
+        if (length < 0)
+        {
+            close(fd);
+            return std::nullopt;
+        }
+
+        if (length == 0)
+            break;
+
+        offset += size_t(length);
+    }
+
+    close(fd);
+
+    source.resize(offset);
+    resolution.source = std::make_shared<const std::string>(std::move(source));
+    return resolution;
+}
+
+std::string RequireCache::normalizeRequire(std::string require)
+{
+    // aliases name a directory of their own and are left alone
+    if (require.find('/') == std::string::npos && (require.empty() || require[0] != '@'))
+        require.insert(0, "./");
+
+    return require;
+}
+
+void RequireCache::clear()
+{
+    std::unique_lock guard(mtx);
+    entries.clear();
+}
+
+void RequireCache::dumpStats(FILE* out) const
+{
+    size_t size = 0;
+
+    {
+        std::shared_lock guard(mtx);
+        size = entries.size();
+    }
+
+    fprintf(
+        out,
+        "require cache: %llu hits, %llu misses, %llu invalidated, %zu entries\n",
+        (unsigned long long)hits.load(),
+        (unsigned long long)misses.load(),
+        (unsigned long long)invalidations.load(),
+        size
+    );
+}
+
+RequireCache::FileStamp RequireCache::statPath(const std::string& path)
+{
+    FileStamp stamp;
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return stamp;
+
+    return stampOf(st);
+}
+
+RequireCache::FileStamp RequireCache::stampOf(const struct stat& st)
+{
+    FileStamp stamp;
+    stamp.exists = true;
+    stamp.inode = uint64_t(st.st_ino);
+#ifdef __APPLE__
+    const timespec& mtime = st.st_mtimespec;
+#else
+    const timespec& mtime = st.st_mtim;
+#endif
+    stamp.mtime = int64_t(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+    stamp.size = uint64_t(st.st_size);
+    return stamp;
+}
+
+std::string RequireCache::makeKey(const std::string& absoluteContext, const std::string& require)
+{
+    // neither part can contain a NUL
+    std::string key = absoluteContext;
+    key += '\0';
+    key += require;
+    return key;
+}
+
+std::optional<std::string> RequireCache::absoluteContextPath(const std::string& contextPath)
+{
+    // relative context paths, like the main script's, are relative to the working directory of the current run
+    if (isAbsolutePath(contextPath))
+        return normalizePath(contextPath);
+
+    std::optional<std::string> cwd = getCurrentWorkingDirectory();
+    if (!cwd)
+        return std::nullopt;
+
+    return normalizePath(joinPaths(*cwd, contextPath));
+}
+
+std::vector<std::string> RequireCache::dependencyPaths(
+    const std::string& absoluteContext,
+    const std::string& require,
+    const std::string& absolutePath
+)
+{
+    std::vector<std::string> paths;
+
+    auto addPath = [&](std::string path)
+    {
+        if (std::find(paths.begin(), paths.end(), path) == paths.end())
+            paths.push_back(std::move(path));
+    };
+
+    addPath(absolutePath);
+
+    // creating or renaming a file in a directory changes its mtime, which catches a new candidate that would now be
+    // resolved instead: module.luau next to module.lua lands in the module's directory, module.luau next to
+    // module/init.luau in the one above it
+    std::optional<std::string> moduleDirectory = getParentPath(absolutePath);
+    if (moduleDirectory)
+    {
+        addPath(*moduleDirectory);
+
+        size_t slash = absolutePath.find_last_of('/');
+        std::string fileName = absolutePath.substr(slash == std::string::npos ? 0 : slash + 1);
+
+        if (fileName == "init.luau" || fileName == "init.lua")
+        {
+            if (std::optional<std::string> parent = getParentPath(*moduleDirectory))
+                addPath(*parent);
+        }
+    }
+
+    std::optional<std::string> contextDirectory = getParentPath(absoluteContext);
+    if (contextDirectory)
+        addPath(*contextDirectory);
+
+    // aliases come from the .luaurc files above the requiring module, nearest first
+    if (!require.empty() && require[0] == '@')
+    {
+        for (std::optional<std::string> directory = contextDirectory; directory; directory = getParentPath(*directory))
+            addPath(joinPaths(*directory, Luau::kConfigName));
+    }
+
+    return paths;
+}
+
+RequireCache& sharedRequireCache()
+{
+    static RequireCache cache;
+    return cache;
+}
+
+}
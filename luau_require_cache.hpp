@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace LuauUtils
+{
+    // Results of RequireResolver shared by analysis (FileResolver::resolveModule) and the runtime (lua_require), so a
+    // require that was resolved once costs a few stats instead of probing every candidate extension and init file and
+    // reading the module again. Entries are keyed on the absolute path of the requiring module, since the daemon runs
+    // requests from different working directories, and are checked on every lookup against everything resolution
+    // depended on: the module file, the directories candidates were probed in and, for aliases, the .luaurc chain.
+    class RequireCache
+    {
+    public:
+        struct FileStamp
+        {
+            bool exists = false;
+            uint64_t inode = 0;
+            int64_t mtime = 0;
+            uint64_t size = 0;
+
+            bool operator==(const FileStamp& other) const
+            {
+                return exists == other.exists && inode == other.inode && mtime == other.mtime && size == other.size;
+            }
+        };
+
+        struct Resolution
+        {
+            // the module path the resolver builds identifiers from: analysis uses it as the module name, the runtime
+            // as its chunk name with a leading '@'
+            std::string path;
+            // absolute path of the module file, also the key modules are cached under in _MODULES
+            std::string absolutePath;
+            std::shared_ptr<const std::string> source;
+            // of the module file, taken before source was read
+            FileStamp stamp;
+        };
+
+        // Reads the module file a resolver settled on into a Resolution that can be added. The file is stamped through
+        // the descriptor it is read from before reading, so an edit racing with the read leaves a stamp that no longer
+        // matches and the entry is dropped on its first lookup, instead of pinning the old source under the new stamp.
+        static std::optional<Resolution> readModule(std::string path, std::string absolutePath);
+
+        // contextPath is the path of the requiring module and require the string it passed to require, normalized
+        // with normalizeRequire
+        std::optional<Resolution> find(const std::string& contextPath, const std::string& require);
+        void add(const std::string& contextPath, const std::string& require, Resolution resolution);
+
+        // Bare module names are relative to the requiring module, so require("module") and require("./module") are
+        // the same require; analysis and the runtime both resolve the normalized string
+        static std::string normalizeRequire(std::string require);
+
+        // Drops every entry; the stats keep counting
+        void clear();
+
+        void dumpStats(FILE* out) const;
+
+    private:
+        struct Entry
+        {
+            Resolution resolution;
+            // every path resolution depended on, with its stamp when the entry was added
+            std::vector<std::pair<std::string, FileStamp>> dependencies;
+        };
+
+        static FileStamp statPath(const std::string& path);
+        static FileStamp stampOf(const struct stat& st);
+        static std::string makeKey(const std::string& absoluteContext, const std::string& require);
+        static std::optional<std::string> absoluteContextPath(const std::string& contextPath);
+        static std::vector<std::string> dependencyPaths(
+            const std::string& absoluteContext,
+            const std::string& require,
+            const std::string& absolutePath
+        );
+
+        mutable std::shared_mutex mtx;
+        std::unordered_map<std::string, Entry> entries;
+
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> invalidations{0};
+    };
+
+    // The cache every resolver in the process shares
+    RequireCache& sharedRequireCache();
+}
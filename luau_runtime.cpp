@@ -0,0 +1,650 @@
+#include <cstring>
+#include <iostream>
+#include <fstream>
+
+#include "lua.h"
+#include "lualib.h"
+
+#include "Luau/Common.h"
+#include "Luau/Compiler.h"
+#include "Luau/FileUtils.h"
+#include "Luau/Require.h"
+#include "Luau/CodeGen.h"
+#include "luau_actor.hpp"
+#include "luau_coverage.hpp"
+#include "luau_profiler.hpp"
+#include "luau_require_cache.hpp"
+#include "luau_runtime.hpp"
+#include "luau_source.hpp"
+#include "luau_trace.hpp"
+#include "luau_utils.hpp"
+
+namespace LuauUtils {
+
+GlobalOptions globalOptions;
+CodegenStats codegenStats;
+std::unique_ptr<BytecodeCache> bytecodeCache;
+std::unique_ptr<PrecompiledChunks> precompiledChunks;
+std::unique_ptr<ChunkCache> chunkCache;
+std::unique_ptr<Bundle> activeBundle;
+
+Luau::CompileOptions copts() {
+	Luau::CompileOptions result = {};
+	result.optimizationLevel = globalOptions.optimizationLevel;
+	result.debugLevel = globalOptions.debugLevel;
+	result.typeInfoLevel = 1;
+	result.coverageLevel = coverageActive() ? 2 : 0;
+	return result;
+}
+
+std::string compileSource(std::string_view source) {
+	if (precompiledChunks) {
+		if (std::optional<std::string> bytecode = precompiledChunks->find(source))
+			return std::move(*bytecode);
+	}
+	if (bytecodeCache)
+		return bytecodeCache->compile(source, copts());
+	return compileBytecode(source, copts());
+}
+
+// luau_load under a trace span
+static int loadChunk(lua_State* L, const char* chunkname, std::string_view bytecode) {
+	TraceSpan span("load", "luau_load", chunkname);
+	return luau_load(L, chunkname, bytecode.data(), bytecode.size(), 0);
+}
+
+void compileNative(lua_State* L, int idx) {
+	Luau::CodeGen::CompilationOptions nativeOptions;
+	Luau::CodeGen::CompilationStats stats = {};
+
+	Luau::CodeGen::CompilationResult result = Luau::CodeGen::compile(L, idx, nativeOptions, &stats);
+
+	codegenStats.chunks++;
+	codegenStats.functionsTotal += stats.functionsTotal;
+	codegenStats.functionsCompiled += stats.functionsCompiled;
+
+	if (result.hasErrors()) {
+		codegenStats.failedChunks++;
+	}
+}
+
+void reportCodegenStats() {
+	uint32_t compiled = codegenStats.functionsCompiled.load();
+	uint32_t interpreted = codegenStats.functionsTotal.load() - compiled;
+	fprintf(stderr, "codegen: %u chunks (%u with failures), %u protos native, %u interpreted\n",
+		codegenStats.chunks.load(), codegenStats.failedChunks.load(), compiled, interpreted);
+}
+
+static int finishrequire(lua_State* L)
+{
+    if (lua_isstring(L, -1))
+        lua_error(L);
+
+    return 1;
+}
+
+// leaves the value require returns on top of ML: what it returned, or an error message
+static void checkModuleResult(lua_State* ML, int status)
+{
+    if (status == 0)
+    {
+        if (lua_gettop(ML) == 0)
+            lua_pushstring(ML, "module must return a value");
+        else if (!lua_istable(ML, -1) && !lua_isfunction(ML, -1))
+            lua_pushstring(ML, "module must return a table or function");
+    }
+    else if (status == LUA_YIELD)
+    {
+        lua_pushstring(ML, "module can not yield");
+    }
+    else if (!lua_isstring(ML, -1))
+    {
+        lua_pushstring(ML, "unknown error while running module");
+    }
+}
+
+// Caches the result of a module that waited on the event loop and hands it to every thread waiting in require
+static void finishModule(lua_State* ML, int status, const std::string& key)
+{
+    checkModuleResult(ML, status);
+
+    // ML may have died with an error, so the main thread does the table work
+    lua_State* GL = lua_mainthread(ML);
+    lua_xmove(ML, GL, 1);
+
+    luaL_findtable(GL, LUA_REGISTRYINDEX, "_MODULES", 1);
+    lua_pushvalue(GL, -2);
+    lua_setfield(GL, -2, key.c_str());
+    lua_pop(GL, 1);
+
+    StateData* data = getStateData(GL);
+    auto loading = data->loadingModules.find(key);
+    std::vector<EventLoop::Wakeup> waiters = std::move(loading->second);
+    data->loadingModules.erase(loading);
+
+    for (const EventLoop::Wakeup& waiter : waiters)
+    {
+        lua_pushvalue(GL, -1);
+        lua_xmove(GL, waiter.thread, 1);
+        data->loop->wake(waiter, 1);
+    }
+
+    lua_pop(GL, 1);
+}
+
+static int lua_requirecont(lua_State* L, int)
+{
+    // L stack: ... result, passed in by finishModule
+    return finishrequire(L);
+}
+
+static int lua_loadstring(lua_State* L) {
+	size_t l = 0;
+	const char* s = luaL_checklstring(L, 1, &l);
+	const char* chunkname = luaL_optstring(L, 2, s);
+
+	lua_setsafeenv(L, LUA_ENVIRONINDEX, false);
+
+	std::string_view source(s, l);
+	std::shared_ptr<const std::string> bytecode;
+
+	// scripts tend to loadstring the same generated code over and over, which then only pays for luau_load
+	if (chunkCache) {
+		ChunkCache::SourceKey key = ChunkCache::SourceKey::of(source);
+		bytecode = chunkCache->find(key);
+		if (!bytecode) {
+			bytecode = std::make_shared<const std::string>(compileSource(source));
+			chunkCache->add(key, bytecode);
+		}
+	} else {
+		bytecode = std::make_shared<const std::string>(compileSource(source));
+	}
+
+	if (loadChunk(L, chunkname, *bytecode) == 0) {
+		if (globalOptions.codegen && globalOptions.codegenLoadstring) {
+			compileNative(L, -1);
+		}
+		return 1;
+	}
+
+	lua_pushnil(L);
+	lua_insert(L, -2); // put before error message
+	return 2;          // return nil plus error message
+}
+
+// same output as the builtin print, but goes to the capture buffer of the state when runScript has set one
+static int lua_print(lua_State* L) {
+	std::string* output = static_cast<std::string*>(lua_getthreaddata(lua_mainthread(L)));
+
+	std::string line;
+	int n = lua_gettop(L);
+	for (int i = 1; i <= n; i++) {
+		size_t l = 0;
+		const char* s = luaL_tolstring(L, i, &l);
+		if (i > 1) {
+			line += '\t';
+		}
+		line.append(s, l);
+		lua_pop(L, 1);
+	}
+	line += '\n';
+
+	if (output) {
+		output->append(line);
+	} else {
+		fwrite(line.data(), 1, line.size(), stdout);
+	}
+	return 0;
+}
+
+static int lua_require(lua_State* L)
+{
+    std::string name = luaL_checkstring(L, 1);
+
+    // covers resolution, compilation and running the module; a module that waits ends the span at the yield
+    TraceSpan span("require", "require", name);
+
+    lua_Debug ar;
+    lua_getinfo(L, 1, "s", &ar);
+
+    RequireResolver::ResolvedRequire resolvedRequire;
+    std::shared_ptr<const std::string> source;
+    std::string_view bundledBytecode;
+
+    // analysis or an earlier state may have resolved and read this require already
+    RequireCache& requireCache = sharedRequireCache();
+    std::string contextPath = ar.source[0] ? ar.source + 1 : "";
+    // resolved like analysis resolves it, so that both share the entry
+    std::string normalizedName = RequireCache::normalizeRequire(name);
+
+    if (activeBundle)
+    {
+        // everything was resolved when the bundle was built, the file system is not consulted
+        std::optional<uint32_t> from = activeBundle->findModule(contextPath);
+        std::optional<uint32_t> module = from ? activeBundle->resolveRequire(*from, name) : std::nullopt;
+        if (!module)
+            luaL_error(L, "module '%s' is not in the bundle", name.c_str());
+
+        std::string moduleName(activeBundle->getName(*module));
+
+        luaL_findtable(L, LUA_REGISTRYINDEX, "_MODULES", 1);
+        lua_getfield(L, -1, moduleName.c_str());
+
+        if (!lua_isnil(L, -1)) {
+            return finishrequire(L);
+        }
+
+        lua_pop(L, 1);
+
+        resolvedRequire.status = RequireResolver::ModuleStatus::FileRead;
+        resolvedRequire.identifier = "@" + moduleName;
+        resolvedRequire.absolutePath = std::move(moduleName);
+        bundledBytecode = activeBundle->getBytecode(*module);
+    }
+    else if (std::optional<RequireCache::Resolution> cached = requireCache.find(contextPath, normalizedName))
+    {
+        luaL_findtable(L, LUA_REGISTRYINDEX, "_MODULES", 1);
+        lua_getfield(L, -1, cached->absolutePath.c_str());
+
+        if (!lua_isnil(L, -1)) {
+            return finishrequire(L);
+        }
+
+        // L stack: _MODULES, like after a resolver reads the file
+        lua_pop(L, 1);
+
+        resolvedRequire.status = RequireResolver::ModuleStatus::FileRead;
+        resolvedRequire.identifier = "@" + cached->path;
+        resolvedRequire.absolutePath = std::move(cached->absolutePath);
+        source = std::move(cached->source);
+    }
+    else
+    {
+        LuauUtils::RuntimeRequireContext requireContext{ar.source};
+        LuauUtils::RuntimeCacheManager cacheManager{L};
+        LuauUtils::RuntimeErrorHandler errorHandler{L};
+
+        RequireResolver resolver(normalizedName, requireContext, cacheManager, errorHandler);
+
+        resolvedRequire = resolver.resolveRequire(
+            [L, &cacheKey = cacheManager.cacheKey](const RequireResolver::ModuleStatus status)
+            {
+                luaL_findtable(L, LUA_REGISTRYINDEX, "_MODULES", 1);
+                if (status == RequireResolver::ModuleStatus::Cached)
+                    lua_getfield(L, -1, cacheKey.c_str());
+            }
+        );
+
+        // the module is read again for the cache, stamped before the read, and that copy is what runs
+        if (resolvedRequire.status == RequireResolver::ModuleStatus::FileRead) {
+            if (std::optional<RequireCache::Resolution> module =
+                    RequireCache::readModule(resolvedRequire.identifier.substr(1), resolvedRequire.absolutePath)) {
+                source = module->source;
+                requireCache.add(contextPath, normalizedName, std::move(*module));
+            } else {
+                source = std::make_shared<const std::string>(std::move(resolvedRequire.sourceCode));
+            }
+        }
+    }
+
+    if (resolvedRequire.status == RequireResolver::ModuleStatus::Cached) {
+        return finishrequire(L);
+    }
+
+    // another thread is running this module and waits on the event loop; running it twice would make two instances
+    StateData* data = getStateData(L);
+    auto loading = data->loadingModules.find(resolvedRequire.absolutePath);
+    if (loading != data->loadingModules.end())
+    {
+        if (!lua_isyieldable(L))
+            luaL_error(L, "module '%s' is still loading and require can not yield here", name.c_str());
+
+        loading->second.push_back(data->loop->suspend(L));
+        return lua_yield(L, 0);
+    }
+
+    // module needs to run in a new thread, isolated from the rest
+    // note: we create ML on main thread so that it doesn't inherit environment of L
+    lua_State* GL = lua_mainthread(L);
+    lua_State* ML = lua_newthread(GL);
+    lua_xmove(GL, L, 1);
+
+    // new thread needs to have the globals sandboxed
+    luaL_sandboxthread(ML);
+
+    // now we can compile & run module on the new thread; bundled modules are compiled already
+    std::string compiled = source ? compileSource(*source) : std::string();
+    std::string_view bytecode = source ? std::string_view(compiled) : bundledBytecode;
+    if (loadChunk(ML, resolvedRequire.identifier.c_str(), bytecode) == 0)
+    {
+        if (globalOptions.codegen)
+            compileNative(ML, -1);
+
+        if (coverageActive())
+            coverageTrack(ML, -1);
+
+        // lets the profiler continue the stack of ML into L
+        std::vector<lua_State*>& requireChain = data->requireChain;
+        requireChain.push_back(L);
+        int status = lua_resume(ML, L, 0);
+        requireChain.pop_back();
+
+        // the module waits on the event loop; L waits for the module and finishes in lua_requirecont
+        if (status == LUA_YIELD && data->loop && data->loop->isSuspended(ML) && lua_isyieldable(L))
+        {
+            std::string key = resolvedRequire.absolutePath;
+            data->loadingModules[key].push_back(data->loop->suspend(L));
+            data->loop->setFinishHook(
+                ML,
+                [key](lua_State* ML, int status)
+                {
+                    finishModule(ML, status, key);
+                }
+            );
+            return lua_yield(L, 0);
+        }
+
+        checkModuleResult(ML, status);
+    }
+
+    // there's now a return value on top of ML; L stack: _MODULES ML
+    lua_xmove(ML, L, 1);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, -4, resolvedRequire.absolutePath.c_str());
+
+    // // L stack: _MODULES ML result
+	return finishrequire(L);
+}
+
+void stateInterrupt(lua_State* L, int gc) {
+	// regular interrupts fire on every call and loop iteration, and only the profiler has anything to do with them
+	if (gc < 0 && !Profiler::anyStarted()) {
+		return;
+	}
+
+	StateData* data = getStateData(L);
+
+	// gc is the phase of a GC step that is about to start or has just ended, or -1 for regular interrupts
+	if (gc >= 0 && (globalOptions.gcStats || traceEnabled())) {
+		if (std::optional<double> seconds = data->gc.onGcInterrupt(gc)) {
+			traceElapsed("gc", lua_gcstatename(gc), *seconds);
+		}
+	}
+
+	if (data->profiler) {
+		data->profiler->onInterrupt(L, gc);
+	}
+}
+
+void checkCodegenSupport() {
+	if (globalOptions.codegen && !Luau::CodeGen::isSupported()) {
+		std::cerr << "Warning: native code generation is not supported on this platform, using the interpreter" << std::endl;
+		globalOptions.codegen = false;
+	}
+}
+
+StateData* getStateData(lua_State* L) {
+	return static_cast<StateData*>(lua_callbacks(L)->userdata);
+}
+
+lua_State* createState() {
+	DEBUG_LOG("Creating Lua state...");
+	lua_State* L = nullptr;
+
+	if (globalOptions.allocator == AllocatorMode::System && globalOptions.memoryLimit == 0 && !globalOptions.memoryStats) {
+		L = luaL_newstate();
+	} else {
+		StateAllocator* allocator = new StateAllocator(globalOptions.allocator, globalOptions.memoryLimit);
+		L = lua_newstate(StateAllocator::alloc, allocator);
+		if (!L) {
+			delete allocator;
+		}
+	}
+
+	if (!L) {
+		std::cout << "Failed to create Lua state" << std::endl;
+		return nullptr;
+	}
+
+	lua_Callbacks* callbacks = lua_callbacks(L);
+	callbacks->userdata = new StateData;
+
+	// GC telemetry and trace spans only need the GC interrupt; nothing is hooked into allocation
+	if (globalOptions.gcStats || traceEnabled()) {
+		callbacks->interrupt = stateInterrupt;
+	}
+
+	// support was settled by checkCodegenSupport before any worker could create a state
+	if (globalOptions.codegen) {
+		DEBUG_LOG("Enabling native code generation...");
+		Luau::CodeGen::create(L);
+	}
+
+	DEBUG_LOG("Opening libraries...");
+	luaL_openlibs(L);
+
+	DEBUG_LOG("Registering functions...");
+	static const luaL_Reg funcs[] = {
+		{"loadstring", lua_loadstring},
+		{"collectgarbage", collectgarbage},
+		{"print", lua_print},
+		{NULL, NULL},
+	};
+
+	lua_pushvalue(L, LUA_GLOBALSINDEX);
+	luaL_register(L, NULL, funcs);
+	lua_pop(L, 1);
+
+	// the continuation finishes requires that waited for a module suspended on the event loop
+	lua_pushcclosurek(L, lua_require, "require", 0, lua_requirecont);
+	lua_setglobal(L, "require");
+
+	openEventLoopLibraries(L);
+	openActorLibrary(L);
+
+	return L;
+}
+
+void reportTo(std::string* output, const std::string& message) {
+	if (output) {
+		output->append(message);
+		output->append("\n");
+	} else {
+		std::cout << message << std::endl;
+	}
+}
+
+int loadScript(lua_State* L, std::string_view script, bool sandboxed, const std::string& chunkname, std::string* output) {
+	DEBUG_LOG("Compiling script...");
+	std::string bytecode = compileSource(script);
+
+    // printf("BYTE CODE: ");
+	// for (unsigned char c : bytecode) {
+	// 	printf("%02X ", c);
+	// }
+	// printf("\n");
+
+	// std::ofstream bytecodeFile("last-run.bytecode", std::ios::binary);
+	// if (bytecodeFile.is_open()) {
+	// 	bytecodeFile.write(bytecode.data(), bytecode.size());
+	// 	bytecodeFile.close();
+	// } else {
+	// 	std::cerr << "Failed to open last-run.bytecode for writing" << std::endl;
+	// }
+
+	return loadBytecode(L, bytecode, sandboxed, chunkname, output);
+}
+
+int loadBytecode(lua_State* L, std::string_view bytecode, bool sandboxed, const std::string& chunkname, std::string* output) {
+	DEBUG_LOG("Creating thread...");
+	lua_State* T = lua_newthread(L);
+	if (!T) {
+		reportTo(output, "Failed to create thread");
+		return LUA_ERRMEM;
+	}
+
+	// sandboxed states have read-only globals, so the script gets a private global table on its thread
+	if (sandboxed) {
+		luaL_sandboxthread(T);
+	}
+
+	DEBUG_LOG("Loading bytecode...");
+	if (loadChunk(T, chunkname.c_str(), bytecode) != 0) {
+		size_t len;
+		const char* msg = lua_tolstring(T, -1, &len);
+		std::string error(msg, len);
+		reportTo(output, "LOAD SCRIPT ERROR: " + error);
+		lua_pop(L, 1);
+		return LUA_ERRSYNTAX;
+	}
+
+	if (globalOptions.codegen) {
+		DEBUG_LOG("Compiling native code...");
+		compileNative(T, -1);
+	}
+
+	if (coverageActive()) {
+		coverageTrack(T, -1);
+	}
+
+	return LUA_OK;
+}
+
+int resumeScript(lua_State* L, std::string* output) {
+	TraceSpan span("run", "execute");
+
+	lua_State* T = lua_tothread(L, -1);
+
+	// print looks the buffer up on the main thread, which every thread and module thread of L shares
+	lua_setthreaddata(lua_mainthread(L), output);
+
+	DEBUG_LOG("Running script...");
+	int status = lua_resume(T, NULL, 0);
+
+	// threads waiting on timers or file I/O keep the run going until all of them are done
+	if (EventLoop* loop = getStateData(L)->loop; loop && loop->hasPending()) {
+		status = loop->run(T, status);
+	}
+
+	if (status != 0) {
+		std::string error;
+
+		if (status == LUA_YIELD) {
+			error = "thread yielded unexpectedly";
+		} else if (const char* str = lua_tostring(T, -1)) {
+			error = str;
+		}
+
+		// error += "\nstack backtrace:\n";
+        error += "\n";
+		error += lua_debugtrace(T);
+
+		reportTo(output, "❌ " + error);
+	}
+
+	lua_pop(L, 1);
+	lua_setthreaddata(lua_mainthread(L), nullptr);
+
+	if (globalOptions.codegen && !output) {
+		reportCodegenStats();
+	}
+
+	if (globalOptions.gcStats) {
+		GcMonitor& gc = getStateData(L)->gc;
+		std::string report = formatGcStats(gc.getStats());
+		if (output) {
+			output->append(report);
+		} else {
+			fputs(report.c_str(), stderr);
+		}
+		gc.resetStats();
+	}
+
+	return status;
+}
+
+int runScript(lua_State* L, std::string_view script, bool sandboxed, const std::string& chunkname, std::string* output) {
+	int status = loadScript(L, script, sandboxed, chunkname, output);
+	if (status != LUA_OK) {
+		return status;
+	}
+
+	return resumeScript(L, output);
+}
+
+void closeState(lua_State* L, std::string* output) {
+	StateAllocator* allocator = StateAllocator::of(L);
+	StateData* data = getStateData(L);
+
+	if (coverageActive()) {
+		coverageCollect(L);
+	}
+
+	lua_close(L);
+	delete data->loop;
+	delete data;
+
+	if (!allocator) {
+		return;
+	}
+
+	char buffer[256];
+	std::string report;
+
+	if (globalOptions.memoryStats) {
+		const MemoryStats& stats = allocator->getStats();
+		snprintf(buffer, sizeof(buffer), "memory: peak %zu bytes, %llu allocations, %llu reallocations, %llu frees\n",
+			stats.peakBytes, (unsigned long long)stats.allocations, (unsigned long long)stats.reallocations,
+			(unsigned long long)stats.frees);
+		report += buffer;
+	}
+
+	// the VM only reports "not enough memory", so say which limit it ran into
+	if (allocator->getStats().limitFailures > 0) {
+		snprintf(buffer, sizeof(buffer), "memory limit of %zu bytes reached %llu times\n",
+			allocator->getLimit(), (unsigned long long)allocator->getStats().limitFailures);
+		report += buffer;
+	}
+
+	if (output) {
+		output->append(report);
+	} else {
+		fputs(report.c_str(), stderr);
+	}
+
+	delete allocator;
+}
+
+bool runLuau(std::string_view script, const std::string& chunkname) {
+	lua_State* L = createState();
+	if (!L) {
+		return false;
+	}
+
+	std::unique_ptr<Profiler> profiler;
+	if (globalOptions.profileFrequency) {
+		profiler = std::make_unique<Profiler>(globalOptions.profileFrequency);
+		profiler->start(L);
+	}
+
+	bool success = runScript(L, script, /* sandboxed= */ false, chunkname) == LUA_OK;
+
+	if (profiler) {
+		profiler->stop();
+		profiler->reportFunctions(stderr, 20);
+
+		if (!profiler->writeFolded(globalOptions.profileOutput)) {
+			std::cerr << "Failed to write profile to " << globalOptions.profileOutput << std::endl;
+		}
+	}
+
+	DEBUG_LOG("Cleaning up...");
+	closeState(L);
+
+	// the actor handles collected with L have joined their threads, so their states are idle
+	closeActorStates();
+
+	return success;
+}
+
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Luau/Compiler.h"
+
+#include "lua.h"
+#include "lualib.h"
+
+#include "luau_allocator.hpp"
+#include "luau_bundle.hpp"
+#include "luau_bytecode_cache.hpp"
+#include "luau_chunk_cache.hpp"
+#include "luau_event_loop.hpp"
+#include "luau_gc.hpp"
+#include "luau_precompiled.hpp"
+
+namespace LuauUtils
+{
+    struct GlobalOptions
+    {
+        int optimizationLevel = 1;
+        int debugLevel = 1;
+        bool cacheStats = false;
+        std::string bytecodeCacheDir = "";
+        bool codegen = false;
+        bool codegenLoadstring = false;
+        std::string analysisCachePath = "";
+        std::string buildId = "";
+        AllocatorMode allocator = AllocatorMode::System;
+        // live bytes a single state may use, 0 for no limit
+        size_t memoryLimit = 0;
+        bool memoryStats = false;
+        // time GC steps and report GC activity after each run
+        bool gcStats = false;
+        // sampling frequency of --profile in Hz, 0 when not profiling
+        unsigned profileFrequency = 0;
+        std::string profileOutput = "profile.out";
+        // lcov file --coverage writes at exit, empty when not collecting coverage
+        std::string coveragePath = "";
+        // per-phase timing and core utilization of analysis
+        bool analysisStats = false;
+        // bytecode kept for repeated loadstring calls, 0 to compile every time
+        size_t chunkCacheSize = 16 << 20;
+        // compile the static require graph of a script in parallel before running it
+        bool preload = true;
+    };
+
+    class Actor;
+    class Profiler;
+
+    // Host-side data of a state from createState, kept in its lua_callbacks userdata
+    struct StateData
+    {
+        GcMonitor gc;
+        Profiler* profiler = nullptr;
+
+        // threads waiting in require for the module thread they resumed, outermost first
+        std::vector<lua_State*> requireChain;
+
+        // registry references to the chunks coverage is collected from
+        std::vector<int> coverageRefs;
+
+        // created by the first task or fs call that needs it
+        EventLoop* loop = nullptr;
+
+        // threads waiting in require for a module that is itself waiting on the event loop, by module key
+        std::unordered_map<std::string, std::vector<EventLoop::Wakeup>> loadingModules;
+
+        // the actor whose script runs on this state, if any
+        Actor* actor = nullptr;
+    };
+
+    struct CodegenStats
+    {
+        std::atomic<unsigned> chunks{0};
+        std::atomic<unsigned> failedChunks{0};
+        std::atomic<uint32_t> functionsTotal{0};
+        std::atomic<uint32_t> functionsCompiled{0};
+    };
+
+    extern GlobalOptions globalOptions;
+    extern CodegenStats codegenStats;
+    extern std::unique_ptr<BytecodeCache> bytecodeCache;
+    extern std::unique_ptr<PrecompiledChunks> precompiledChunks;
+    extern std::unique_ptr<ChunkCache> chunkCache;
+    // set while runBundle runs a bundle; lua_require then loads modules from it instead of the file system
+    extern std::unique_ptr<Bundle> activeBundle;
+
+    Luau::CompileOptions copts();
+
+    // all compilation goes through here so that the bytecode cache sees every chunk
+    std::string compileSource(std::string_view source);
+
+    // native-compiles the function at idx and accounts for it in codegenStats
+    void compileNative(lua_State* L, int idx);
+    void reportCodegenStats();
+
+    // Turns --codegen off with a warning when the platform can't generate native code. Called once after the options
+    // are parsed, so that states created on worker threads only ever read the option.
+    void checkCodegenSupport();
+
+    // Creates a state with libraries opened and loadstring, require, collectgarbage, print, task, fs and actor registered.
+    // States get their own StateAllocator unless the system allocator is used without a limit or stats.
+    lua_State* createState();
+
+    // The StateData of a state from createState, or nullptr
+    StateData* getStateData(lua_State* L);
+
+    // Interrupt callback of states from createState, dispatching to their GC monitor and profiler
+    void stateInterrupt(lua_State* L, int gc);
+
+    // Appends message and a newline to output, or prints it to stdout when there is no output buffer
+    void reportTo(std::string* output, const std::string& message);
+
+    // Closes a state from createState along with its allocator and data, collecting its coverage and reporting its
+    // memory use when asked to; the report is appended to output when given, like runScript's, instead of going to
+    // stderr
+    void closeState(lua_State* L, std::string* output = nullptr);
+
+    // Compiles and runs script on a new thread of L; errors are printed and the resume status is returned.
+    // Sandboxed runs give the thread its own globals on top of the read-only ones set up by luaL_sandbox.
+    // When output is given, print and error messages and GC stats are appended to it instead of going to stdout and
+    // stderr, and codegen stats are left for the caller to report.
+    int runScript(
+        lua_State* L, std::string_view script, bool sandboxed = false, const std::string& chunkname = "=script",
+        std::string* output = nullptr
+    );
+
+    // The two halves of runScript. loadScript leaves the loaded thread on top of L when it returns LUA_OK, so that
+    // compilation can happen ahead of time; resumeScript runs the thread on top of L and pops it.
+    int loadScript(
+        lua_State* L, std::string_view script, bool sandboxed = false, const std::string& chunkname = "=script",
+        std::string* output = nullptr
+    );
+    int resumeScript(lua_State* L, std::string* output = nullptr);
+
+    // loadScript for bytecode that is already compiled
+    int loadBytecode(
+        lua_State* L, std::string_view bytecode, bool sandboxed = false, const std::string& chunkname = "=script",
+        std::string* output = nullptr
+    );
+
+    // Runs script on a new state; -f runs pass "@" and the file's path so that errors, requires and coverage name it
+    bool runLuau(std::string_view script, const std::string& chunkname = "=script");
+}
@@ -0,0 +1,172 @@
+#include "luau_source.hpp"
+#include "luau_trace.hpp"
+#include "Luau/BytecodeBuilder.h"
+#include "Luau/FileUtils.h"
+#include "Luau/Parser.h"
+
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace LuauUtils {
+
+namespace {
+
+// Same as readFile: a first line starting with #! is dropped, keeping the newline so line numbers don't shift
+size_t shebangLength(std::string_view contents)
+{
+    if (contents.size() < 2 || contents[0] != '#' || contents[1] != '!')
+        return 0;
+
+    size_t newline = contents.find('\n');
+    return newline == std::string_view::npos ? contents.size() : newline;
+}
+
+}
+
+std::optional<SourceFile> SourceFile::open(const std::string& path)
+{
+    TraceSpan span("io", "read", path);
+
+    std::optional<std::string> contents = path == "-" ? readStdin() : readFile(path);
+    if (!contents)
+        return std::nullopt;
+
+    return fromString(std::move(*contents));
+}
+
+std::optional<SourceFile> SourceFile::map(const std::string& path)
+{
+    if (path == "-")
+        return open(path);
+
+    TraceSpan span("io", "map", path);
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return std::nullopt;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return std::nullopt;
+    }
+
+    if (S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void* mapping = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (mapping != MAP_FAILED)
+        {
+            // sources are read front to back by the lexer
+            madvise(mapping, size_t(st.st_size), MADV_SEQUENTIAL);
+
+            SourceFile file;
+            file.mapping = mapping;
+            file.mappingSize = size_t(st.st_size);
+            file.offset = shebangLength(std::string_view(static_cast<const char*>(mapping), file.mappingSize));
+            return file;
+        }
+    }
+    else
+    {
+        close(fd);
+    }
+
+    return open(path);
+}
+
+SourceFile SourceFile::fromString(std::string contents)
+{
+    SourceFile file;
+    file.buffer = std::move(contents);
+    file.offset = shebangLength(file.buffer);
+    return file;
+}
+
+SourceFile::SourceFile(SourceFile&& other) noexcept
+    : mapping(std::exchange(other.mapping, nullptr))
+    , mappingSize(std::exchange(other.mappingSize, 0))
+    , offset(std::exchange(other.offset, 0))
+    , buffer(std::move(other.buffer))
+{
+}
+
+SourceFile& SourceFile::operator=(SourceFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        mapping = std::exchange(other.mapping, nullptr);
+        mappingSize = std::exchange(other.mappingSize, 0);
+        offset = std::exchange(other.offset, 0);
+        buffer = std::move(other.buffer);
+    }
+
+    return *this;
+}
+
+SourceFile::~SourceFile()
+{
+    reset();
+}
+
+std::string_view SourceFile::view() const
+{
+    if (mapping)
+        return std::string_view(static_cast<const char*>(mapping) + offset, mappingSize - offset);
+
+    return std::string_view(buffer).substr(offset);
+}
+
+bool SourceFile::isMapped() const
+{
+    return mapping != nullptr;
+}
+
+void SourceFile::reset()
+{
+    if (mapping)
+        munmap(mapping, mappingSize);
+
+    mapping = nullptr;
+    mappingSize = 0;
+    offset = 0;
+    buffer.clear();
+}
+
+std::string compileBytecode(std::string_view source, const Luau::CompileOptions& options)
+{
+    TraceSpan span("compile", "compile");
+
+    Luau::Allocator allocator;
+    Luau::AstNameTable names(allocator);
+    Luau::ParseResult result = Luau::Parser::parse(source.data(), source.size(), names, allocator, Luau::ParseOptions());
+
+    if (!result.errors.empty())
+    {
+        // callers expect only a single error message
+        const Luau::ParseError& parseError = result.errors.front();
+        std::string error = ":" + std::to_string(parseError.getLocation().begin.line + 1) + ": " + parseError.getMessage();
+        return Luau::BytecodeBuilder::getError(error);
+    }
+
+    try
+    {
+        Luau::BytecodeBuilder bcb;
+        Luau::compileOrThrow(bcb, result, names, options);
+        return bcb.getBytecode();
+    }
+    catch (const Luau::CompileError& e)
+    {
+        std::string error = ":" + std::to_string(e.getLocation().begin.line + 1) + ": " + e.what();
+        return Luau::BytecodeBuilder::getError(error);
+    }
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "Luau/Compiler.h"
+
+namespace LuauUtils
+{
+    // Read-only contents of a source file. A leading shebang line is skipped the same way readFile does.
+    class SourceFile
+    {
+    public:
+        // Reads the file into memory; "-" reads stdin. Sources are edited in place while the daemon and watch mode
+        // run, so they are never mapped.
+        static std::optional<SourceFile> open(const std::string& path);
+
+        // Memory-maps a regular file so its contents are never copied; other files fall back to open. Only for inputs
+        // nothing rewrites while they are in use, such as bundles: truncating a mapped file raises SIGBUS on access.
+        static std::optional<SourceFile> map(const std::string& path);
+        static SourceFile fromString(std::string contents);
+
+        SourceFile() = default;
+        SourceFile(SourceFile&& other) noexcept;
+        SourceFile& operator=(SourceFile&& other) noexcept;
+        ~SourceFile();
+
+        SourceFile(const SourceFile&) = delete;
+        SourceFile& operator=(const SourceFile&) = delete;
+
+        // Valid for as long as this object is alive
+        std::string_view view() const;
+        bool isMapped() const;
+
+    private:
+        void reset();
+
+        void* mapping = nullptr;
+        size_t mappingSize = 0;
+        size_t offset = 0;
+        std::string buffer;
+    };
+
+    // Luau::compile for a source that is neither owned nor null-terminated, such as a mapped file.
+    // Errors are encoded into the returned bytecode exactly like Luau::compile does.
+    std::string compileBytecode(std::string_view source, const Luau::CompileOptions& options);
+}
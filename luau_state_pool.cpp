@@ -0,0 +1,154 @@
+#include "luau_state_pool.hpp"
+#include "luau_coverage.hpp"
+#include "luau_runtime.hpp"
+
+#include <algorithm>
+
+namespace LuauUtils {
+
+StatePool::StatePool(size_t maxStates)
+    : maxStates(std::max<size_t>(maxStates, 1))
+{
+}
+
+StatePool::~StatePool()
+{
+    for (lua_State* L : idle)
+        closeState(L);
+}
+
+void StatePool::warm(size_t count)
+{
+    std::vector<lua_State*> states;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        lua_State* L = acquire();
+        if (!L)
+            break;
+
+        states.push_back(L);
+    }
+
+    for (lua_State* L : states)
+        release(L, LUA_OK);
+}
+
+StatePool::RunStatus StatePool::run(std::string_view script)
+{
+    lua_State* L = acquire();
+    if (!L)
+        return RunStatus::StateLost;
+
+    int status = runScript(L, script, /* sandboxed= */ true);
+
+    return release(L, status);
+}
+
+lua_State* StatePool::acquire()
+{
+    std::unique_lock guard(mtx);
+
+    cv.wait(
+        guard,
+        [this]
+        {
+            return !idle.empty() || liveStates < maxStates;
+        }
+    );
+
+    if (!idle.empty())
+    {
+        lua_State* L = idle.back();
+        idle.pop_back();
+        return L;
+    }
+
+    // reserve the slot and prepare outside of the lock, setup is the expensive part
+    liveStates++;
+    guard.unlock();
+
+    lua_State* L = prepare();
+
+    guard.lock();
+
+    if (!L)
+    {
+        liveStates--;
+        cv.notify_one();
+        return nullptr;
+    }
+
+    createdStates++;
+    return L;
+}
+
+StatePool::RunStatus StatePool::release(lua_State* L, int status)
+{
+    // after a memory error or an error in the error handler the state can't be trusted any more
+    bool recoverable = status != LUA_ERRMEM && status != LUA_ERRERR && lua_status(L) == LUA_OK;
+
+    // threads left on the event loop or waiting for a module would resume inside the next script
+    if (StateData* data = getStateData(L))
+    {
+        if ((data->loop && !data->loop->isIdle()) || !data->loadingModules.empty())
+            recoverable = false;
+    }
+
+    if (recoverable)
+    {
+        lua_settop(L, 0);
+
+        // the chunks this run loaded would otherwise stay referenced for as long as the state is pooled
+        if (coverageActive())
+            coverageCollect(L);
+
+        // modules are cached per run; the next script must not observe them
+        lua_pushnil(L);
+        lua_setfield(L, LUA_REGISTRYINDEX, "_MODULES");
+
+        // collectgarbage can retune or stop the collector, which the next script should not inherit
+        if (StateData* data = getStateData(L))
+            data->gc.resetTuning(L);
+
+        // host code may have unfrozen the globals, in which case the sandbox no longer holds
+        recoverable = lua_getreadonly(L, LUA_GLOBALSINDEX) != 0;
+    }
+
+    if (!recoverable)
+        closeState(L);
+
+    {
+        std::unique_lock guard(mtx);
+
+        if (recoverable)
+            idle.push_back(L);
+        else
+            liveStates--;
+    }
+
+    cv.notify_one();
+
+    if (!recoverable)
+        return RunStatus::StateLost;
+
+    return status == LUA_OK ? RunStatus::Ok : RunStatus::ScriptError;
+}
+
+size_t StatePool::getCreatedCount() const
+{
+    std::unique_lock guard(mtx);
+    return createdStates;
+}
+
+lua_State* StatePool::prepare()
+{
+    lua_State* L = createState();
+    if (!L)
+        return nullptr;
+
+    luaL_sandbox(L);
+    return L;
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lua.h"
+#include "lualib.h"
+
+namespace LuauUtils
+{
+    // Pool of prepared states: libraries opened, host functions registered and globals frozen with luaL_sandbox.
+    // Every execution runs on a fresh luaL_sandboxthread thread, and per-run state such as the _MODULES registry
+    // table is cleared when the state is released. States that can't be trusted after a run are closed instead.
+    class StatePool
+    {
+    public:
+        enum class RunStatus
+        {
+            Ok,
+            ScriptError,
+            // the script ran out of memory or left the state inconsistent; the state was discarded
+            StateLost,
+        };
+
+        explicit StatePool(size_t maxStates);
+        ~StatePool();
+
+        StatePool(const StatePool&) = delete;
+        StatePool& operator=(const StatePool&) = delete;
+
+        // Prepares states up front so that the first runs don't pay for setup
+        void warm(size_t count);
+
+        // Runs script on a pooled state, blocking while all states are in use
+        RunStatus run(std::string_view script);
+
+        // Hands out a prepared state; nullptr if a new state could not be created
+        lua_State* acquire();
+        // Returns a state to the pool after a run that finished with the given resume status
+        RunStatus release(lua_State* L, int status);
+
+        size_t getCreatedCount() const;
+
+    private:
+        lua_State* prepare();
+
+        size_t maxStates = 1;
+        size_t liveStates = 0;
+        size_t createdStates = 0;
+
+        mutable std::mutex mtx;
+        std::condition_variable cv;
+        std::vector<lua_State*> idle;
+    };
+}
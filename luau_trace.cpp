@@ -0,0 +1,188 @@
+#include "luau_trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace LuauUtils {
+
+std::atomic<bool> traceActive{false};
+
+namespace {
+
+// a thread stops recording past this, so that a long-running daemon can't grow without bound
+constexpr size_t kMaxEventsPerThread = 1 << 20;
+
+struct Event
+{
+    const char* category;
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+    std::string detail;
+};
+
+// Only its own thread appends; the mutex is there for traceWrite and is otherwise uncontended
+struct ThreadBuffer
+{
+    std::mutex mtx;
+    uint32_t tid = 0;
+    std::string name;
+    std::vector<Event> events;
+    size_t dropped = 0;
+};
+
+std::chrono::steady_clock::time_point origin;
+
+std::mutex buffersMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+// shared with buffers, so that events outlive threads that exit before the trace is written
+thread_local std::shared_ptr<ThreadBuffer> threadBuffer;
+
+ThreadBuffer& currentBuffer()
+{
+    if (!threadBuffer)
+    {
+        threadBuffer = std::make_shared<ThreadBuffer>();
+
+        std::unique_lock guard(buffersMutex);
+        threadBuffer->tid = uint32_t(buffers.size() + 1);
+        buffers.push_back(threadBuffer);
+    }
+
+    return *threadBuffer;
+}
+
+void writeString(FILE* file, std::string_view str)
+{
+    fputc('"', file);
+
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            fprintf(file, "\\%c", c);
+        else if (static_cast<unsigned char>(c) < 0x20)
+            fprintf(file, "\\u%04x", c);
+        else
+            fputc(c, file);
+    }
+
+    fputc('"', file);
+}
+
+}
+
+void traceStart()
+{
+    origin = std::chrono::steady_clock::now();
+    traceActive.store(true);
+
+    traceThreadName("main");
+}
+
+bool traceWrite(const std::string& path)
+{
+    traceActive.store(false);
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    bool first = true;
+    auto separate = [&]
+    {
+        fputs(first ? "" : ",\n", file);
+        first = false;
+    };
+
+    std::unique_lock guard(buffersMutex);
+
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers)
+    {
+        std::unique_lock bufferGuard(buffer->mtx);
+
+        if (!buffer->name.empty())
+        {
+            separate();
+            fprintf(file, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", buffer->tid);
+            writeString(file, buffer->name);
+            fputs("}}", file);
+        }
+
+        for (const Event& event : buffer->events)
+        {
+            separate();
+            fputs("{\"ph\":\"X\",\"cat\":", file);
+            writeString(file, event.category);
+            fputs(",\"name\":", file);
+            writeString(file, event.name);
+            fprintf(file, ",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", buffer->tid, double(event.start) / 1e3,
+                double(event.end - event.start) / 1e3);
+
+            if (!event.detail.empty())
+            {
+                fputs(",\"args\":{\"detail\":", file);
+                writeString(file, event.detail);
+                fputc('}', file);
+            }
+
+            fputc('}', file);
+        }
+
+        if (buffer->dropped)
+            fprintf(stderr, "trace: dropped %zu events of thread %u past the limit of %zu\n", buffer->dropped, buffer->tid,
+                kMaxEventsPerThread);
+    }
+
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
+
+uint64_t traceNow()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count()) + 1;
+}
+
+void traceThreadName(const std::string& name)
+{
+    if (!traceEnabled())
+        return;
+
+    ThreadBuffer& buffer = currentBuffer();
+
+    std::unique_lock guard(buffer.mtx);
+    buffer.name = name;
+}
+
+void traceEvent(const char* category, const char* name, uint64_t start, uint64_t end, std::string_view detail)
+{
+    ThreadBuffer& buffer = currentBuffer();
+
+    std::unique_lock guard(buffer.mtx);
+
+    if (buffer.events.size() >= kMaxEventsPerThread)
+    {
+        buffer.dropped++;
+        return;
+    }
+
+    buffer.events.push_back({category, name, start, end, std::string(detail)});
+}
+
+void traceElapsed(const char* category, const char* name, double seconds, std::string_view detail)
+{
+    if (!traceEnabled())
+        return;
+
+    uint64_t end = traceNow();
+    uint64_t duration = uint64_t(seconds * 1e9);
+
+    traceEvent(category, name, duration < end ? end - duration : 1, end, detail);
+}
+
+}
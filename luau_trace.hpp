@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace LuauUtils
+{
+    // Timed spans written as Chrome trace-event JSON by --trace, for chrome://tracing or Perfetto. Every thread records
+    // into a buffer of its own, so tracing threads never wait on each other; when tracing is off, a span costs one
+    // relaxed load and records nothing.
+    extern std::atomic<bool> traceActive;
+
+    inline bool traceEnabled()
+    {
+        return traceActive.load(std::memory_order_relaxed);
+    }
+
+    void traceStart();
+    // Stops recording and writes everything recorded so far
+    bool traceWrite(const std::string& path);
+
+    // nanoseconds since traceStart, never 0
+    uint64_t traceNow();
+
+    // Names the calling thread in the trace; a no-op when tracing is off
+    void traceThreadName(const std::string& name);
+
+    void traceEvent(const char* category, const char* name, uint64_t start, uint64_t end, std::string_view detail = {});
+    // a span of seconds that ends now, for work timed by someone else like GC steps
+    void traceElapsed(const char* category, const char* name, double seconds, std::string_view detail = {});
+
+    // Records the time between construction and destruction. category and name must outlive the trace, which string
+    // literals do; detail is copied only when tracing is on.
+    class TraceSpan
+    {
+    public:
+        TraceSpan(const char* category, const char* name, std::string_view detail = {})
+            : category(category)
+            , name(name)
+            , start(traceEnabled() ? traceNow() : 0)
+        {
+            if (start)
+                this->detail = detail;
+        }
+
+        ~TraceSpan()
+        {
+            if (start)
+                traceEvent(category, name, start, traceNow(), detail);
+        }
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+    private:
+        const char* category;
+        const char* name;
+        uint64_t start;
+        std::string detail;
+    };
+}
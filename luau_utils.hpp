@@ -1,15 +1,21 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <unordered_map>
 #include <vector>
 #include <utility>
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
 #include <condition_variable>
 #include <queue>
 #include <functional>
+#include <iostream>
 #include "Luau/FileResolver.h"
 #include "Luau/Ast.h"
 #include "Luau/FileUtils.h"
@@ -21,6 +27,12 @@
 #include "lua.h"
 #include "lualib.h"
 
+#ifndef DEBUG
+#define DEBUG 0
+#endif
+
+#define DEBUG_LOG(msg) do { if (DEBUG) std::cout << "[DEBUG] " << msg << std::endl; } while (0)
+
 namespace LuauUtils
 {
     enum class ReportFormat
@@ -30,12 +42,31 @@ namespace LuauUtils
         Gnu,
     };
 
+    // A single reported error or warning, kept so that results can be replayed without re-checking
+    struct Diagnostic
+    {
+        std::string name;
+        Luau::Location location;
+        std::string type;
+        std::string message;
+    };
+
     void report(ReportFormat format, const char* name, const Luau::Location& loc, const char* type, const char* message);
-    void reportError(const Luau::Frontend& frontend, ReportFormat format, const Luau::TypeError& error);
-    void reportWarning(ReportFormat format, const char* name, const Luau::LintWarning& warning);
-    bool reportModuleResult(Luau::Frontend& frontend, const Luau::ModuleName& name, ReportFormat format, bool annotate);
+    void report(ReportFormat format, const Diagnostic& diagnostic);
+    void reportError(const Luau::Frontend& frontend, ReportFormat format, const Luau::TypeError& error, std::vector<Diagnostic>* diagnostics = nullptr);
+    void reportWarning(ReportFormat format, const char* name, const Luau::LintWarning& warning, std::vector<Diagnostic>* diagnostics = nullptr);
+    bool reportModuleResult(
+        Luau::Frontend& frontend,
+        const Luau::ModuleName& name,
+        ReportFormat format,
+        bool annotate,
+        std::vector<Diagnostic>* diagnostics = nullptr
+    );
     int assertionHandler(const char* expr, const char* file, int line, const char* function);
 
+    // Fast non-cryptographic 64-bit hash used for cache keys and change detection
+    uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
     class FileResolver : public Luau::FileResolver
     {
     public:
@@ -43,24 +74,99 @@ namespace LuauUtils
         std::optional<Luau::ModuleInfo> resolveModule(const Luau::ModuleInfo* context, Luau::AstExpr* node) override;
         std::string getHumanReadableModuleName(const Luau::ModuleName& name) const override;
 
+        // Hash of the source most recently returned by readSource for this module
+        std::optional<uint64_t> getSourceHash(const Luau::ModuleName& name) const;
+
+        // Serves name from memory instead of reading the file, for sources the caller has already read.
+        // The text is not copied until the Frontend asks for it, so it has to outlive the resolver.
+        void addSource(const Luau::ModuleName& name, std::string_view source);
+
+        // Called with the text of every source read, before it is handed to the Frontend; may run on worker threads
+        using SourceObserver = std::function<void(const Luau::ModuleName& name, std::string_view source)>;
+        void setSourceObserver(SourceObserver observer);
+
+        // Normalized require strings of the module that resolved to no file, so that creating the file later can be
+        // noticed by whoever kept the results
+        std::vector<std::string> getUnresolvedRequires(const Luau::ModuleName& name) const;
+
+        // Resolves a normalized require string of the module context the way resolveModule does, bypassing the
+        // shared RequireCache; the module name on success
+        static std::optional<Luau::ModuleName> resolveRequire(const Luau::ModuleName& context, const std::string& require);
+
     private:
+        mutable std::mutex sourceHashMutex;
+        std::unordered_map<Luau::ModuleName, uint64_t> sourceHashes;
+        std::unordered_map<Luau::ModuleName, std::string_view> addedSources;
+        SourceObserver sourceObserver;
+
+        mutable std::mutex unresolvedMutex;
+        std::unordered_map<Luau::ModuleName, std::vector<std::string>> unresolvedRequires;
+
         struct AnalysisRequireContext;
         struct AnalysisCacheManager;
         struct AnalysisErrorHandler;
     };
 
+    // Resolves the .luaurc chain of a module, caching the merged config of every directory. getConfig may be called
+    // from several analysis workers at once; hits only take a shared lock on one shard of the cache.
     class ConfigResolver : public Luau::ConfigResolver
     {
     public:
         explicit ConfigResolver(Luau::Mode mode);
         const Luau::Config& getConfig(const Luau::ModuleName& name) const override;
-        mutable std::vector<std::pair<std::string, std::string>> configErrors;
+
+        // Stats the .luaurc of every cached directory and drops the cache when any of them was created, edited or
+        // replaced since it was read. Returns whether that happened, in which case every module may need a re-check.
+        // Must not run concurrently with getConfig; references it returned before stay valid until the next refresh.
+        bool refresh();
+
+        // Parse errors of the config files read since the last refresh that dropped the cache, as {path, error}
+        std::vector<std::pair<std::string, std::string>> getErrors() const;
 
     private:
+        struct FileStamp
+        {
+            bool exists = false;
+            uint64_t device = 0;
+            uint64_t inode = 0;
+            int64_t mtime = 0;
+            uint64_t size = 0;
+
+            bool operator==(const FileStamp& other) const
+            {
+                return exists == other.exists && device == other.device && inode == other.inode && mtime == other.mtime &&
+                       size == other.size;
+            }
+        };
+
+        struct Entry
+        {
+            Luau::Config config;
+            std::string configPath;
+            FileStamp stamp;
+        };
+
+        struct Shard
+        {
+            std::shared_mutex mutex;
+            std::unordered_map<std::string, std::shared_ptr<const Entry>> entries;
+        };
+
+        static constexpr size_t kShardCount = 16;
+
+        static FileStamp statFile(const std::string& path);
+
         const Luau::Config& readConfigRec(const std::string& path) const;
+        Shard& shardFor(const std::string& path) const;
 
         Luau::Config defaultConfig;
-        mutable std::unordered_map<std::string, Luau::Config> configCache;
+        mutable std::array<Shard, kShardCount> shards;
+
+        // entries dropped by the last refresh, kept alive for references handed out before it
+        std::vector<std::shared_ptr<const Entry>> retired;
+
+        mutable std::mutex errorsMutex;
+        mutable std::vector<std::pair<std::string, std::string>> errors;
     };
 
     class TaskScheduler
@@ -0,0 +1,247 @@
+#include "luau_watch.hpp"
+
+// change notifications come from inotify; other platforms report watch mode as unsupported
+#ifdef __linux__
+
+#include "luau_analyzer.hpp"
+#include "luau_runtime.hpp"
+#include "luau_source.hpp"
+#include "luau_state_pool.hpp"
+
+#include "Luau/Config.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace LuauUtils {
+
+namespace {
+
+// editors save by writing in place or by renaming a new file over the old one, so whole directories are watched
+constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+
+// how long to keep collecting events after the first one, so that a save touching several files triggers one run
+constexpr int kQuietMilliseconds = 30;
+
+const char* const kConfigKey = "";
+
+class Watcher
+{
+public:
+    Watcher()
+        : fd(inotify_init1(IN_CLOEXEC))
+    {
+    }
+
+    ~Watcher()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    Watcher(const Watcher&) = delete;
+    Watcher& operator=(const Watcher&) = delete;
+
+    bool isValid() const
+    {
+        return fd >= 0;
+    }
+
+    // forgets the files of the last run; directory watches are kept, since the next run mostly needs the same ones
+    void clearFiles()
+    {
+        files.clear();
+    }
+
+    // reports changes to path as key
+    void watchFile(const std::string& path, const std::string& key)
+    {
+        std::filesystem::path file(path);
+        std::string directory = file.has_parent_path() ? file.parent_path().string() : ".";
+
+        auto it = directories.find(directory);
+        if (it == directories.end())
+        {
+            int wd = inotify_add_watch(fd, directory.c_str(), kWatchMask);
+            if (wd < 0)
+                return;
+
+            it = directories.emplace(directory, wd).first;
+        }
+
+        files[it->second][file.filename().string()] = key;
+    }
+
+    // Blocks until a watched file changes and returns the keys of everything that changed by the time it went quiet
+    std::unordered_set<std::string> wait()
+    {
+        std::unordered_set<std::string> changed;
+
+        // no timeout until the first relevant event, then a short one to coalesce what follows
+        while (collect(changed, changed.empty() ? -1 : kQuietMilliseconds))
+        {
+        }
+
+        return changed;
+    }
+
+private:
+    // returns false once nothing arrived within timeout
+    bool collect(std::unordered_set<std::string>& changed, int timeout)
+    {
+        pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout) <= 0)
+            return timeout < 0;
+
+        alignas(inotify_event) char buffer[16 * 1024];
+        ssize_t length = ::read(fd, buffer, sizeof(buffer));
+
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->len == 0)
+                continue;
+
+            auto directory = files.find(event->wd);
+            if (directory == files.end())
+                continue;
+
+            auto file = directory->second.find(event->name);
+            if (file != directory->second.end())
+                changed.insert(file->second);
+        }
+
+        return true;
+    }
+
+    int fd = -1;
+    std::unordered_map<std::string, int> directories;
+    std::unordered_map<int, std::unordered_map<std::string, std::string>> files;
+};
+
+// .luaurc files apply to everything below them, so every directory up to the root can hold one that matters
+void watchConfigs(Watcher& watcher, const std::vector<std::string>& modules)
+{
+    std::unordered_set<std::string> seen;
+
+    for (const std::string& module : modules)
+    {
+        std::error_code ec;
+        std::filesystem::path directory = std::filesystem::absolute(module, ec).parent_path();
+
+        while (!ec && seen.insert(directory.string()).second)
+        {
+            watcher.watchFile((directory / Luau::kConfigName).string(), kConfigKey);
+
+            if (!directory.has_parent_path() || directory.parent_path() == directory)
+                break;
+
+            directory = directory.parent_path();
+        }
+    }
+}
+
+}
+
+int runWatch(const std::string& scriptFilePath, bool runAnalyzer)
+{
+    Watcher watcher;
+    if (!watcher.isValid())
+    {
+        perror("inotify_init1");
+        return 1;
+    }
+
+    std::unique_ptr<Analyzer> analyzer;
+    if (runAnalyzer)
+        analyzer = std::make_unique<Analyzer>(Luau::Mode::Strict, ReportFormat::Default, WorkStealingScheduler::getThreadCount());
+
+    StatePool pool(1);
+    pool.warm(1);
+
+    for (;;)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        bool passed = !analyzer || analyzer->check({scriptFilePath}) == 0;
+
+        if (passed)
+        {
+            if (std::optional<SourceFile> file = SourceFile::open(scriptFilePath))
+            {
+                if (pool.run(file->view()) == StatePool::RunStatus::StateLost)
+                    fprintf(stderr, "the Luau state became unrecoverable and was discarded\n");
+            }
+            else
+            {
+                fprintf(stderr, "Could not open file %s\n", scriptFilePath.c_str());
+            }
+        }
+
+        fflush(stdout);
+        fprintf(
+            stderr,
+            "[watch] %s in %.2f ms, waiting for changes...\n",
+            passed ? "ran" : "analysis failed",
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+        );
+
+        // the require closure can change with every edit, so the watched set is rebuilt after each check
+        std::vector<std::string> modules = {scriptFilePath};
+        if (analyzer)
+        {
+            std::vector<Luau::ModuleName> closure = analyzer->dependencyOrder({scriptFilePath});
+            modules.insert(modules.end(), closure.begin(), closure.end());
+        }
+
+        watcher.clearFiles();
+        for (const std::string& module : modules)
+            watcher.watchFile(module, module);
+        watchConfigs(watcher, modules);
+
+        std::unordered_set<std::string> changed = watcher.wait();
+
+        if (!analyzer)
+            continue;
+
+        // a config edit can affect every module; refresh drops the config cache and marks them all dirty
+        if (changed.count(kConfigKey))
+            analyzer->refresh();
+
+        // marks the module and everything depending on it, which is all the next check has to redo
+        for (const std::string& name : changed)
+        {
+            if (name != kConfigKey)
+                analyzer->getFrontend().markDirty(name);
+        }
+    }
+}
+
+}
+
+#else
+
+#include <cstdio>
+
+namespace LuauUtils {
+
+int runWatch(const std::string&, bool)
+{
+    fprintf(stderr, "Error: --watch is only supported on Linux\n");
+    return 1;
+}
+
+}
+
+#endif
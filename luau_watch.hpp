@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+namespace LuauUtils
+{
+    // Runs scriptFilePath, then waits for the script, any module it requires or a .luaurc above them to change and
+    // runs it again, until the process is terminated. Analysis stays warm between runs and only re-checks changed
+    // modules and their dependents; runs reuse a pooled state. Linux only, elsewhere it reports an error and returns 1.
+    int runWatch(const std::string& scriptFilePath, bool runAnalyzer);
+}
@@ -0,0 +1,225 @@
+#include "luau_work_stealing.hpp"
+#include "luau_trace.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace LuauUtils {
+
+namespace {
+
+// Number of full scans over all queues an idle worker performs before parking; after the first few it also yields
+// so that spinning workers don't starve busy ones when the pool is larger than the machine
+constexpr int kIdleSpinRounds = 64;
+constexpr int kIdlePauseRounds = 16;
+
+thread_local const WorkStealingScheduler* currentScheduler = nullptr;
+thread_local unsigned currentWorker = 0;
+
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+}
+
+void WorkStealingScheduler::SpinLock::lock()
+{
+    for (;;)
+    {
+        if (!locked.exchange(true, std::memory_order_acquire))
+            return;
+
+        while (locked.load(std::memory_order_relaxed))
+            cpuRelax();
+    }
+}
+
+void WorkStealingScheduler::SpinLock::unlock()
+{
+    locked.store(false, std::memory_order_release);
+}
+
+void WorkStealingScheduler::WorkerQueue::pushBack(Task&& task)
+{
+    if (size == ring.size())
+    {
+        std::vector<Task> grown(std::max<size_t>(ring.size() * 2, 64));
+
+        for (size_t i = 0; i < size; i++)
+            grown[i] = std::move(ring[(head + i) % ring.size()]);
+
+        ring = std::move(grown);
+        head = 0;
+    }
+
+    ring[(head + size) % ring.size()] = std::move(task);
+    size++;
+}
+
+bool WorkStealingScheduler::WorkerQueue::popBack(Task& task)
+{
+    if (size == 0)
+        return false;
+
+    size--;
+    task = std::move(ring[(head + size) % ring.size()]);
+    return true;
+}
+
+bool WorkStealingScheduler::WorkerQueue::popFront(Task& task)
+{
+    if (size == 0)
+        return false;
+
+    task = std::move(ring[head]);
+    head = (head + 1) % ring.size();
+    size--;
+    return true;
+}
+
+WorkStealingScheduler::WorkStealingScheduler(unsigned threadCount)
+    : threadCount(std::max(threadCount, 1u))
+    , queues(new WorkerQueue[std::max(threadCount, 1u)])
+{
+    for (unsigned i = 0; i < this->threadCount; i++)
+    {
+        workers.emplace_back(
+            [this, i]
+            {
+                workerFunction(i);
+            }
+        );
+    }
+}
+
+WorkStealingScheduler::~WorkStealingScheduler()
+{
+    {
+        std::unique_lock guard(parkMutex);
+        stopping.store(true);
+    }
+
+    parkCv.notify_all();
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void WorkStealingScheduler::push(Task task)
+{
+    // workers keep their own tasks local; everyone else spreads work over the pool
+    unsigned target = currentScheduler == this ? currentWorker : nextQueue.fetch_add(1, std::memory_order_relaxed) % threadCount;
+
+    WorkerQueue& queue = queues[target];
+    queue.lock.lock();
+    queue.pushBack(std::move(task));
+    queue.lock.unlock();
+
+    // counted once the task is in a queue, so that a worker woken by the count always finds it; a thief can take the
+    // task first and leave the count at -1 until here, which reads as no work. This pairs with the sleeping increment
+    // in workerFunction: either the pusher sees a sleeper or the sleeper sees the count before waiting
+    pending.fetch_add(1);
+
+    if (sleeping.load() > 0)
+    {
+        std::unique_lock guard(parkMutex);
+        parkCv.notify_one();
+    }
+}
+
+unsigned WorkStealingScheduler::getThreadCount()
+{
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+bool WorkStealingScheduler::tryAcquire(unsigned self, Task& task)
+{
+    // acquire pairs with the increment in push, so that the queue locks below see the task it counted
+    if (pending.load(std::memory_order_acquire) <= 0)
+        return false;
+
+    WorkerQueue& own = queues[self];
+    own.lock.lock();
+    bool found = own.popBack(task);
+    own.lock.unlock();
+
+    for (unsigned i = 1; !found && i < threadCount; i++)
+    {
+        WorkerQueue& victim = queues[(self + i) % threadCount];
+
+        victim.lock.lock();
+        found = victim.popFront(task);
+        victim.lock.unlock();
+    }
+
+    if (found)
+        pending.fetch_sub(1, std::memory_order_relaxed);
+
+    return found;
+}
+
+void WorkStealingScheduler::workerFunction(unsigned index)
+{
+    currentScheduler = this;
+    currentWorker = index;
+
+    if (traceEnabled())
+        traceThreadName("worker " + std::to_string(index));
+
+    // on a single core spinning can only delay the thread that would produce work
+    int spinRounds = std::thread::hardware_concurrency() > 1 ? kIdleSpinRounds : 1;
+
+    Task task;
+
+    for (;;)
+    {
+        bool found = false;
+
+        for (int round = 0; round < spinRounds && !found; round++)
+        {
+            found = tryAcquire(index, task);
+
+            if (found)
+                break;
+            else if (round < kIdlePauseRounds)
+                cpuRelax();
+            else
+                std::this_thread::yield();
+        }
+
+        if (found)
+        {
+            task();
+            task = Task();
+            continue;
+        }
+
+        std::unique_lock guard(parkMutex);
+
+        sleeping.fetch_add(1);
+        parkCv.wait(
+            guard,
+            [this]
+            {
+                return pending.load() > 0 || stopping.load();
+            }
+        );
+        sleeping.fetch_sub(1);
+
+        // queues are drained before exiting so that every pushed task runs
+        if (stopping.load() && pending.load() <= 0)
+            break;
+    }
+
+    currentScheduler = nullptr;
+}
+
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace LuauUtils
+{
+    // Move-only type-erased callable with inline storage.
+    // Anything that fits in kInlineSize bytes (which includes std::function<void()>) is stored without a heap allocation.
+    class Task
+    {
+    public:
+        static constexpr size_t kInlineSize = 48;
+
+        Task() = default;
+
+        template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+        Task(F&& f)
+        {
+            using Fn = std::decay_t<F>;
+            static_assert(sizeof(Fn) <= kInlineSize, "Task callable is too large for inline storage");
+            static_assert(alignof(Fn) <= alignof(std::max_align_t), "Task callable is over-aligned");
+
+            new (storage) Fn(std::forward<F>(f));
+            ops = &OpsFor<Fn>::table;
+        }
+
+        Task(Task&& other) noexcept
+        {
+            moveFrom(other);
+        }
+
+        Task& operator=(Task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                moveFrom(other);
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task()
+        {
+            reset();
+        }
+
+        explicit operator bool() const
+        {
+            return ops != nullptr;
+        }
+
+        void operator()()
+        {
+            ops->invoke(storage);
+        }
+
+    private:
+        struct Ops
+        {
+            void (*invoke)(void* self);
+            void (*move)(void* dst, void* src);
+            void (*destroy)(void* self);
+        };
+
+        template<typename Fn>
+        struct OpsFor
+        {
+            static void invoke(void* self)
+            {
+                (*static_cast<Fn*>(self))();
+            }
+
+            static void move(void* dst, void* src)
+            {
+                new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+                static_cast<Fn*>(src)->~Fn();
+            }
+
+            static void destroy(void* self)
+            {
+                static_cast<Fn*>(self)->~Fn();
+            }
+
+            static constexpr Ops table = {invoke, move, destroy};
+        };
+
+        void moveFrom(Task& other)
+        {
+            ops = other.ops;
+            if (ops)
+                ops->move(storage, other.storage);
+            other.ops = nullptr;
+        }
+
+        void reset()
+        {
+            if (ops)
+                ops->destroy(storage);
+            ops = nullptr;
+        }
+
+        alignas(std::max_align_t) unsigned char storage[kInlineSize];
+        const Ops* ops = nullptr;
+    };
+
+    // Scheduler with a deque per worker: owners push and pop at the back, idle workers steal from the front of others.
+    // Tasks pushed from outside the pool are distributed round-robin. Idle workers spin briefly before parking.
+    class WorkStealingScheduler
+    {
+    public:
+        explicit WorkStealingScheduler(unsigned threadCount);
+        ~WorkStealingScheduler();
+
+        WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+        WorkStealingScheduler& operator=(const WorkStealingScheduler&) = delete;
+
+        void push(Task task);
+        static unsigned getThreadCount();
+
+    private:
+        class SpinLock
+        {
+        public:
+            void lock();
+            void unlock();
+
+        private:
+            std::atomic<bool> locked{false};
+        };
+
+        // Growable ring buffer guarded by a per-worker spin lock; only the owner and thieves ever touch it
+        struct alignas(64) WorkerQueue
+        {
+            SpinLock lock;
+            std::vector<Task> ring;
+            size_t head = 0;
+            size_t size = 0;
+
+            void pushBack(Task&& task);
+            bool popBack(Task& task);
+            bool popFront(Task& task);
+        };
+
+        bool tryAcquire(unsigned self, Task& task);
+        void workerFunction(unsigned index);
+
+        unsigned threadCount = 1;
+        std::unique_ptr<WorkerQueue[]> queues;
+        std::vector<std::thread> workers;
+
+        std::atomic<unsigned> nextQueue{0};
+        // tasks in queues; briefly -1 per task taken before push counted it
+        std::atomic<ptrdiff_t> pending{0};
+        std::atomic<unsigned> sleeping{0};
+        std::atomic<bool> stopping{false};
+
+        std::mutex parkMutex;
+        std::condition_variable parkCv;
+    };
+}
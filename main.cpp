@@ -1,358 +1,217 @@
 #include <__config>
 #include <cstddef>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <thread>
+#include <vector>
 
 #include "lua.h"
 #include "lualib.h"
 
 #include "Luau/Common.h"
-#include "Luau/Compiler.h"
-#include "Luau/Ast.h"
-#include "Luau/Parser.h"
-#include "Luau/ParseOptions.h"
-#include "Luau/Allocator.h"
-#include "Luau/Module.h"
-#include "Luau/Linter.h"
-#include "Luau/TypeArena.h"
-#include "Luau/Type.h"
-#include "Luau/Frontend.h"
-#include "Luau/TypeInfer.h"
-#include "Luau/ToString.h"
-#include "Luau/TypeChecker2.h"
-#include "Luau/NotNull.h"
-#include "Luau/BuiltinDefinitions.h"
 #include "Luau/FileUtils.h"
-#include "Luau/Require.h"
-#include "Luau/TypeAttach.h"
-#include "Luau/Transpiler.h"
 #include "luau_utils.hpp"
-
-#ifndef DEBUG
-#define DEBUG 0
-#endif
-
-#define DEBUG_LOG(msg) do { if (DEBUG) std::cout << "[DEBUG] " << msg << std::endl; } while (0)
-
-struct GlobalOptions {
-	int optimizationLevel = 1;
-	int debugLevel = 1;
-} globalOptions;
-
-static Luau::CompileOptions copts() {
-	Luau::CompileOptions result = {};
-	result.optimizationLevel = globalOptions.optimizationLevel;
-	result.debugLevel = globalOptions.debugLevel;
-	result.typeInfoLevel = 1;
-	// result.coverageLevel = coverageActive() ? 2 : 0;
-	result.coverageLevel = 0;
-	return result;
-}
-
-static int finishrequire(lua_State* L)
-{
-    if (lua_isstring(L, -1))
-        lua_error(L);
-
-    return 1;
-}
-
-static int lua_loadstring(lua_State* L) {
-	size_t l = 0;
-	const char* s = luaL_checklstring(L, 1, &l);
-	const char* chunkname = luaL_optstring(L, 2, s);
-
-	lua_setsafeenv(L, LUA_ENVIRONINDEX, false);
-
-	std::string bytecode = Luau::compile(std::string(s, l), copts());
-	if (luau_load(L, chunkname, bytecode.data(), bytecode.size(), 0) == 0) {
-		return 1;
+#include "luau_bytecode_cache.hpp"
+#include "luau_analyzer.hpp"
+#include "luau_runtime.hpp"
+#include "luau_daemon.hpp"
+#include "luau_batch.hpp"
+#include "luau_bundle.hpp"
+#include "luau_pipeline.hpp"
+#include "luau_coverage.hpp"
+#include "luau_watch.hpp"
+#include "luau_preload.hpp"
+#include "luau_require_cache.hpp"
+#include "luau_profiler.hpp"
+#include "luau_source.hpp"
+#include "luau_trace.hpp"
+
+using LuauUtils::globalOptions;
+using LuauUtils::bytecodeCache;
+
+// byte counts with an optional k, m or g suffix
+static size_t parseByteSize(const std::string& value) {
+	size_t end = 0;
+	unsigned long long size = std::stoull(value, &end);
+	std::string suffix = value.substr(end);
+
+	if (suffix == "k" || suffix == "K") {
+		size <<= 10;
+	} else if (suffix == "m" || suffix == "M") {
+		size <<= 20;
+	} else if (suffix == "g" || suffix == "G") {
+		size <<= 30;
+	} else if (!suffix.empty()) {
+		throw std::invalid_argument("invalid size: " + value);
 	}
 
-	lua_pushnil(L);
-	lua_insert(L, -2); // put before error message
-	return 2;          // return nil plus error message
+	return size_t(size);
 }
 
-static int lua_collectgarbage(lua_State* L) {
-	const char* option = luaL_optstring(L, 1, "collect");
-	if (strcmp(option, "collect") == 0) {
-		lua_gc(L, LUA_GCCOLLECT, 0);
-		return 0;
-	}
-	if (strcmp(option, "count") == 0) {
-		int c = lua_gc(L, LUA_GCCOUNT, 0);
-		lua_pushnumber(L, c);
-		return 1;
-	}
-	luaL_error(L, "collectgarbage must be called with 'count' or 'collect'");
-}
-
-static int lua_require(lua_State* L)
-{
-    std::string name = luaL_checkstring(L, 1);
-
-    RequireResolver::ResolvedRequire resolvedRequire;
-    {
-        lua_Debug ar;
-        lua_getinfo(L, 1, "s", &ar);
-
-        LuauUtils::RuntimeRequireContext requireContext{ar.source};
-        LuauUtils::RuntimeCacheManager cacheManager{L};
-        LuauUtils::RuntimeErrorHandler errorHandler{L};
-
-        RequireResolver resolver(std::move(name), requireContext, cacheManager, errorHandler);
-
-        resolvedRequire = resolver.resolveRequire(
-            [L, &cacheKey = cacheManager.cacheKey](const RequireResolver::ModuleStatus status)
-            {
-                lua_getfield(L, LUA_REGISTRYINDEX, "_MODULES");
-                if (status == RequireResolver::ModuleStatus::Cached)
-                    lua_getfield(L, -1, cacheKey.c_str());
-            }
-        );
-    }
-
-    if (resolvedRequire.status == RequireResolver::ModuleStatus::Cached) {
-        return finishrequire(L);
-    }
-
-    // module needs to run in a new thread, isolated from the rest
-    // note: we create ML on main thread so that it doesn't inherit environment of L
-    lua_State* GL = lua_mainthread(L);
-    lua_State* ML = lua_newthread(GL);
-    lua_xmove(GL, L, 1);
-
-    // new thread needs to have the globals sandboxed
-    luaL_sandboxthread(ML);
-
-    // now we can compile & run module on the new thread
-    std::string bytecode = Luau::compile(resolvedRequire.sourceCode, copts());
-    if (luau_load(ML, resolvedRequire.identifier.c_str(), bytecode.data(), bytecode.size(), 0) == 0)
-    {
-        // if (codegen)
-        // {
-        //     Luau::CodeGen::CompilationOptions nativeOptions;
-        //     Luau::CodeGen::compile(ML, -1, nativeOptions);
-        // }
-
-        // if (coverageActive())
-        //     coverageTrack(ML, -1);
-
-        int status = lua_resume(ML, L, 0);
-
-        if (status == 0)
-        {
-            if (lua_gettop(ML) == 0)
-                lua_pushstring(ML, "module must return a value");
-            else if (!lua_istable(ML, -1) && !lua_isfunction(ML, -1))
-                lua_pushstring(ML, "module must return a table or function");
-        }
-        else if (status == LUA_YIELD)
-        {
-            lua_pushstring(ML, "module can not yield");
-        }
-        else if (!lua_isstring(ML, -1))
-        {
-            lua_pushstring(ML, "unknown error while running module");
-        }
-    }
-
-    // there's now a return value on top of ML; L stack: _MODULES ML
-    lua_xmove(ML, L, 1);
-    lua_pushvalue(L, -1);
-    lua_setfield(L, -4, resolvedRequire.absolutePath.c_str());
-
-    // // L stack: _MODULES ML result
-	return finishrequire(L);
-}
-
-void runLuau(const std::string& script) {
-	DEBUG_LOG("Creating Lua state...");
-	lua_State* L = luaL_newstate();
-	if (!L) {
-		std::cout << "Failed to create Lua state" << std::endl;
+static void dumpCacheStats() {
+	if (!globalOptions.cacheStats) {
 		return;
 	}
-
-	DEBUG_LOG("Opening libraries...");
-	luaL_openlibs(L);
-
-	DEBUG_LOG("Registering functions...");
-	static const luaL_Reg funcs[] = {
-		{"loadstring", lua_loadstring},
-		{"require", lua_require},
-		{"collectgarbage", lua_collectgarbage},
-		{NULL, NULL},
-	};
-
-	lua_pushvalue(L, LUA_GLOBALSINDEX);
-	luaL_register(L, NULL, funcs);
-	lua_pop(L, 1);
-
-	DEBUG_LOG("Compiling script...");
-	std::string bytecode = Luau::compile(script, copts());
-
-    // printf("BYTE CODE: ");
-	// for (unsigned char c : bytecode) {
-	// 	printf("%02X ", c);
-	// }
-	// printf("\n");
-
-	// std::ofstream bytecodeFile("last-run.bytecode", std::ios::binary);
-	// if (bytecodeFile.is_open()) {
-	// 	bytecodeFile.write(bytecode.data(), bytecode.size());
-	// 	bytecodeFile.close();
-	// } else {
-	// 	std::cerr << "Failed to open last-run.bytecode for writing" << std::endl;
-	// }
-	
-	DEBUG_LOG("Loading bytecode...");
-	if (luau_load(L, "=script", bytecode.data(), bytecode.size(), 0) != 0) {
-		size_t len;
-		const char* msg = lua_tolstring(L, -1, &len);
-		std::string error(msg, len);
-		std::cout << "LOAD SCRIPT ERROR: " << error << std::endl;
-		lua_close(L);
-		return;
+	if (bytecodeCache) {
+		bytecodeCache->dumpStats(stderr);
 	}
-
-	DEBUG_LOG("Creating thread...");
-	lua_State* T = lua_newthread(L);
-	if (!T) {
-		std::cout << "Failed to create thread" << std::endl;
-			lua_close(L);
-			return;
+	if (LuauUtils::chunkCache) {
+		LuauUtils::chunkCache->dumpStats(stderr);
 	}
+	LuauUtils::sharedRequireCache().dumpStats(stderr);
+}
 
-	lua_pushvalue(L, -2);
-	lua_remove(L, -3);
-	lua_xmove(L, T, 1);
-
-	DEBUG_LOG("Running script...");
-	int status = lua_resume(T, NULL, 0);
-
-	if (status != 0) {
-		std::string error;
+// Writes the trace when main returns, whichever way it does
+struct TraceWriter {
+	std::string path;
 
-		if (status == LUA_YIELD) {
-			error = "thread yielded unexpectedly";
-		} else if (const char* str = lua_tostring(T, -1)) {
-			error = str;
+	~TraceWriter() {
+		if (!path.empty() && !LuauUtils::traceWrite(path)) {
+			std::cerr << "Failed to write trace to " << path << std::endl;
 		}
-
-		// error += "\nstack backtrace:\n";
-        error += "\n";
-		error += lua_debugtrace(T);
-
-		std::cout << "❌ " << error << std::endl;
-		lua_pop(L, 1);
 	}
-
-	DEBUG_LOG("Cleaning up...");
-	lua_close(L);
+};
+
+// The daemon runs with the options it was started with, so a run that sets any of its own has to happen in-process
+static bool hasRunOptions(const TraceWriter& traceWriter) {
+	const LuauUtils::GlobalOptions defaults;
+
+	return globalOptions.codegen != defaults.codegen || globalOptions.codegenLoadstring != defaults.codegenLoadstring ||
+		globalOptions.bytecodeCacheDir != defaults.bytecodeCacheDir || globalOptions.analysisCachePath != defaults.analysisCachePath ||
+		globalOptions.allocator != defaults.allocator || globalOptions.memoryLimit != defaults.memoryLimit ||
+		globalOptions.memoryStats != defaults.memoryStats || globalOptions.gcStats != defaults.gcStats ||
+		globalOptions.profileFrequency != defaults.profileFrequency || globalOptions.profileOutput != defaults.profileOutput ||
+		globalOptions.coveragePath != defaults.coveragePath || globalOptions.analysisStats != defaults.analysisStats ||
+		globalOptions.chunkCacheSize != defaults.chunkCacheSize || globalOptions.cacheStats != defaults.cacheStats ||
+		globalOptions.preload != defaults.preload || !traceWriter.path.empty();
 }
 
-bool analyzeLuau(const std::string& scriptFilePath) {
-    Luau::assertHandler() = LuauUtils::assertionHandler;
-
-    LuauUtils::ReportFormat format = LuauUtils::ReportFormat::Default;
-    Luau::Mode mode = Luau::Mode::Strict;
-    bool annotate = false;
-    int threadCount = 0;
-    std::string basePath = "";
-
-    Luau::FrontendOptions frontendOptions;
-    frontendOptions.retainFullTypeGraphs = annotate;
-    frontendOptions.runLintChecks = true;
-
-    LuauUtils::FileResolver fileResolver;
-    LuauUtils::ConfigResolver configResolver(mode);
-    Luau::Frontend frontend(&fileResolver, &configResolver, frontendOptions);
-
-    Luau::registerBuiltinGlobals(frontend, frontend.globals);
-    Luau::freeze(frontend.globals.globalTypes);
-
-    std::vector<std::string> files = {
-        scriptFilePath,
-    };
-
-    for (const std::string& path : files)
-        frontend.queueModuleCheck(path);
-
-    std::vector<Luau::ModuleName> checkedModules;
-
-    if (threadCount <= 0)
-        threadCount = std::min(LuauUtils::TaskScheduler::getThreadCount(), 8u);
-
-    try
-    {
-        LuauUtils::TaskScheduler scheduler(threadCount);
-
-        checkedModules = frontend.checkQueuedModules(
-            std::nullopt,
-            [&](std::function<void()> f)
-            {
-                scheduler.push(std::move(f));
-            }
-        );
-    }
-    catch (const Luau::InternalCompilerError& ice)
-    {
-        Luau::Location location = ice.location ? *ice.location : Luau::Location();
-
-        std::string moduleName = ice.moduleName ? *ice.moduleName : "<unknown module>";
-        std::string humanReadableName = frontend.fileResolver->getHumanReadableModuleName(moduleName);
-
-        Luau::TypeError error(location, moduleName, Luau::InternalError{ice.message});
-
-        LuauUtils::reportError(frontend, format, error);
-        return false;
-    }
-
-    int failed = 0;
-
-    for (const Luau::ModuleName& name : checkedModules)
-        failed += !LuauUtils::reportModuleResult(frontend, name, format, annotate);
-
-    if (!configResolver.configErrors.empty())
-    {
-        failed += int(configResolver.configErrors.size());
-
-        for (const auto& pair : configResolver.configErrors)
-            fprintf(stderr, "%s: %s\n", pair.first.c_str(), pair.second.c_str());
-    }
-
-    // if (format == ReportFormat::Luacheck) {
-	// 	// return 0;
-	// } else {
-    //     // return failed ? 1 : 0;
-	// }
-
-    // std::cout << "DONE ANALYZING - FAILED: " << failed << std::endl;
-	// std::cout << "DONE ANALYZING" << std::endl;
-
-    return failed == 0;
+// every state has been closed by the time this runs, so all of their coverage has been collected
+static void writeCoverage() {
+	if (LuauUtils::coverageActive() && !LuauUtils::coverageDump(globalOptions.coveragePath)) {
+		std::cerr << "Failed to write coverage to " << globalOptions.coveragePath << std::endl;
+	}
 }
 
 int main(int argc, char* argv[]) {
 	std::string script;
+	std::optional<LuauUtils::SourceFile> scriptFile;
 	std::string scriptFilePath = "";
 	bool runAnalyzer = true;
+	std::string daemonSocket = "";
+	std::string clientSocket = "";
+	bool batch = false;
+	bool pipeline = false;
+	bool analyzeOnly = false;
+	bool watch = false;
+	std::string bundlePath = "";
+	std::string runBundlePath = "";
+	unsigned jobs = 0;
+	std::string manifestPath = "";
+	std::vector<std::string> positional;
+	LuauUtils::BatchOptions batchOptions;
 
 	if (argc < 2) {
-		std::cout << "Usage: " << argv[0] << " <script_string> or " << argv[0] << " -f <script_file> [--analyzer=0|1]" << std::endl;
+		std::cout << "Usage: " << argv[0] << " <script_string> or " << argv[0] << " -f <script_file> [--analyzer=0|1] [--bytecode-cache[=<dir>]] [--cache-stats] [--chunk-cache=<bytes>[k|m|g]] [--codegen[=all]] [--analysis-cache[=<file>]] [--daemon[=<socket>]] [--client[=<socket>]] [--pipeline] [--allocator=system|pool|arena] [--memory-limit=<bytes>[k|m|g]] [--memory-stats] [--gc-stats] [--profile[=<hz>]] [--profile-output=<file>] [--coverage[=<file>]] [--watch] [--preload=0|1] [--bundle=<file>] [--trace=<file>]" << std::endl;
+		std::cout << "       " << argv[0] << " --run-bundle=<file>" << std::endl;
+		std::cout << "       " << argv[0] << " --batch [--manifest=<file>] [--jobs=<n>] [<script_file>...]" << std::endl;
+		std::cout << "       " << argv[0] << " --analyze [--jobs=<n>] [--analysis-stats] <dir|glob|@file_list|module>..." << std::endl;
 		return 1;
 	}
 
+	globalOptions.buildId = LuauUtils::BytecodeCache::currentBuildId(argv[0]);
+
+	// looked for ahead of the other options, so that the trace covers the read of the -f file
+	TraceWriter traceWriter;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg.substr(0, 8) == "--trace=") {
+			traceWriter.path = arg.substr(8);
+			LuauUtils::traceStart();
+		}
+	}
+
 	try {
 		// Parse command line arguments
 		for (int i = 1; i < argc; i++) {
 			std::string arg = argv[i];
 			if (arg.substr(0, 11) == "--analyzer=") {
 				runAnalyzer = (arg.substr(11) == "1");
+			} else if (arg == "--bytecode-cache") {
+				globalOptions.bytecodeCacheDir = LuauUtils::BytecodeCache::defaultDirectory();
+			} else if (arg.substr(0, 17) == "--bytecode-cache=") {
+				globalOptions.bytecodeCacheDir = arg.substr(17);
+			} else if (arg == "--analysis-cache") {
+				globalOptions.analysisCachePath = ".luau-analysis-cache";
+			} else if (arg.substr(0, 17) == "--analysis-cache=") {
+				globalOptions.analysisCachePath = arg.substr(17);
+			} else if (arg == "--codegen") {
+				globalOptions.codegen = true;
+			} else if (arg == "--codegen=all") {
+				globalOptions.codegen = true;
+				globalOptions.codegenLoadstring = true;
+			} else if (arg == "--daemon") {
+				daemonSocket = LuauUtils::defaultDaemonSocketPath();
+			} else if (arg.substr(0, 9) == "--daemon=") {
+				daemonSocket = arg.substr(9);
+			} else if (arg == "--client") {
+				clientSocket = LuauUtils::defaultDaemonSocketPath();
+			} else if (arg.substr(0, 9) == "--client=") {
+				clientSocket = arg.substr(9);
+			} else if (arg == "--pipeline") {
+				pipeline = true;
+			} else if (arg.substr(0, 10) == "--preload=") {
+				globalOptions.preload = (arg.substr(10) == "1");
+			} else if (arg.substr(0, 9) == "--bundle=") {
+				bundlePath = arg.substr(9);
+			} else if (arg.substr(0, 13) == "--run-bundle=") {
+				runBundlePath = arg.substr(13);
+			} else if (arg.substr(0, 8) == "--trace=") {
+				// handled before parsing
+			} else if (arg == "--watch") {
+				watch = true;
+			} else if (arg == "--analyze") {
+				analyzeOnly = true;
+			} else if (arg == "--analysis-stats") {
+				globalOptions.analysisStats = true;
+			} else if (arg == "--batch") {
+				batch = true;
+			} else if (arg.substr(0, 11) == "--manifest=") {
+				batch = true;
+				manifestPath = arg.substr(11);
+			} else if (arg.substr(0, 7) == "--jobs=") {
+				jobs = unsigned(std::max(std::stoi(arg.substr(7)), 0));
+			} else if (arg.substr(0, 12) == "--allocator=") {
+				std::string mode = arg.substr(12);
+				if (mode == "system") {
+					globalOptions.allocator = LuauUtils::AllocatorMode::System;
+				} else if (mode == "pool") {
+					globalOptions.allocator = LuauUtils::AllocatorMode::Pool;
+				} else if (mode == "arena") {
+					globalOptions.allocator = LuauUtils::AllocatorMode::Arena;
+				} else {
+					std::cout << "Error: Unknown allocator " << mode << std::endl;
+					return 1;
+				}
+			} else if (arg.substr(0, 15) == "--memory-limit=") {
+				globalOptions.memoryLimit = parseByteSize(arg.substr(15));
+			} else if (arg == "--memory-stats") {
+				globalOptions.memoryStats = true;
+			} else if (arg == "--gc-stats") {
+				globalOptions.gcStats = true;
+			} else if (arg == "--profile") {
+				globalOptions.profileFrequency = LuauUtils::Profiler::kDefaultFrequency;
+			} else if (arg.substr(0, 10) == "--profile=") {
+				globalOptions.profileFrequency = unsigned(std::max(std::stoi(arg.substr(10)), 1));
+			} else if (arg.substr(0, 17) == "--profile-output=") {
+				globalOptions.profileOutput = arg.substr(17);
+			} else if (arg == "--coverage") {
+				globalOptions.coveragePath = "coverage.out";
+			} else if (arg.substr(0, 11) == "--coverage=") {
+				globalOptions.coveragePath = arg.substr(11);
+			} else if (arg.substr(0, 14) == "--chunk-cache=") {
+				globalOptions.chunkCacheSize = parseByteSize(arg.substr(14));
+			} else if (arg == "--cache-stats") {
+				globalOptions.cacheStats = true;
 			} else if (arg == "-f") {
 				if (i + 1 >= argc) {
 					std::cout << "Error: No file specified after -f flag" << std::endl;
@@ -361,30 +220,154 @@ int main(int argc, char* argv[]) {
 				scriptFilePath = argv[++i];
 
 				DEBUG_LOG("Reading file: " << scriptFilePath);
-				std::ifstream file(scriptFilePath);
-				if (!file.is_open()) {
+				scriptFile = LuauUtils::SourceFile::open(scriptFilePath);
+				if (!scriptFile) {
 					std::cout << "Error: Could not open file " << scriptFilePath << std::endl;
 					return 1;
 				}
+			} else {
+				positional.push_back(arg);
+				if (script.empty()) {
+					script = arg;
+				}
+			}
+		}
+
+		LuauUtils::checkCodegenSupport();
+
+		// -f files are read once here; an inline script is used as is
+		std::string_view source = scriptFile ? scriptFile->view() : std::string_view(script);
+
+		// the daemon does the work when one is listening; otherwise fall through and run in-process
+		if (clientSocket != "" && !batch && !analyzeOnly && !watch && bundlePath == "" && runBundlePath == "" && !hasRunOptions(traceWriter)) {
+			LuauUtils::DaemonRequest request;
+			request.cwd = getCurrentWorkingDirectory().value_or(".");
+			request.scriptFilePath = scriptFilePath;
+			request.script = scriptFilePath == "" ? script : "";
+			request.runAnalyzer = runAnalyzer;
+
+			if (std::optional<int> exitCode = LuauUtils::runDaemonClient(clientSocket, request)) {
+				return *exitCode;
+			}
+		}
+
+		if (!globalOptions.bytecodeCacheDir.empty()) {
+			bytecodeCache = std::make_unique<LuauUtils::BytecodeCache>(
+				globalOptions.bytecodeCacheDir, globalOptions.buildId);
+		}
+
+		if (globalOptions.chunkCacheSize > 0) {
+			LuauUtils::chunkCache = std::make_unique<LuauUtils::ChunkCache>(globalOptions.chunkCacheSize);
+		}
+
+		if (daemonSocket != "") {
+			return LuauUtils::runDaemon(daemonSocket);
+		}
+
+		// everything was compiled and resolved when the bundle was built, so there is nothing to analyze or preload
+		if (runBundlePath != "") {
+			bool success = LuauUtils::runBundle(runBundlePath);
+			writeCoverage();
+
+			dumpCacheStats();
+			return success ? 0 : 1;
+		}
+
+		// in batch mode every positional argument is a script file
+		if (batch) {
+			std::vector<std::string> files = positional;
+			if (manifestPath != "") {
+				std::optional<std::vector<std::string>> manifest = LuauUtils::readManifest(manifestPath);
+				if (!manifest) {
+					std::cout << "Error: Could not open manifest " << manifestPath << std::endl;
+					return 1;
+				}
+				files.insert(files.end(), manifest->begin(), manifest->end());
+			}
+
+			batchOptions.jobs = jobs;
+			batchOptions.runAnalyzer = runAnalyzer;
+			int exitCode = LuauUtils::runBatch(files, batchOptions);
+			writeCoverage();
 
-				std::stringstream buffer;
-				buffer << file.rdbuf();
-				script = buffer.str();
-			} else if (script.empty()) {
-				script = arg;
+			dumpCacheStats();
+			return exitCode;
+		}
+
+		// checks a whole project without running anything
+		if (analyzeOnly) {
+			std::vector<std::string> inputs = positional;
+			if (scriptFilePath != "") {
+				inputs.push_back(scriptFilePath);
 			}
+
+			std::vector<std::string> files = LuauUtils::collectModuleFiles(inputs);
+			if (files.empty()) {
+				std::cout << "Error: No modules found" << std::endl;
+				return 1;
+			}
+
+			LuauUtils::AnalyzeOptions analyzeOptions;
+			analyzeOptions.threadCount = jobs;
+
+			return LuauUtils::analyzeLuau(files, analyzeOptions) ? 0 : 1;
+		}
+
+		if (watch) {
+			if (scriptFilePath == "") {
+				std::cout << "Error: --watch needs a script file given with -f" << std::endl;
+				return 1;
+			}
+			return LuauUtils::runWatch(scriptFilePath, runAnalyzer);
+		}
+
+		// compiles while analysis runs instead of after it
+		if (scriptFilePath != "" && runAnalyzer && pipeline) {
+			DEBUG_LOG("Running analysis and compilation...");
+			bool success = LuauUtils::runPipelined(scriptFilePath, source);
+			writeCoverage();
+
+			dumpCacheStats();
+			return success ? 0 : 1;
 		}
 
 		if (scriptFilePath != "" && runAnalyzer) {
 			DEBUG_LOG("Running analysis...");
-			bool success = analyzeLuau(scriptFilePath);
+
+			// the analyzer uses the source read above and compiles from its AST, so nothing is read or parsed twice
+			LuauUtils::precompiledChunks = std::make_unique<LuauUtils::PrecompiledChunks>();
+
+			LuauUtils::AnalyzeOptions analyzeOptions;
+			analyzeOptions.sources[scriptFilePath] = source;
+			analyzeOptions.compileInto = LuauUtils::precompiledChunks.get();
+
+			bool success = LuauUtils::analyzeLuau({scriptFilePath}, analyzeOptions);
 			if (success == false) {
 				return 1;
 			}
 		}
+
+		// bundling happens after analysis, when that is enabled, and does not run the script
+		if (bundlePath != "") {
+			if (scriptFilePath == "") {
+				std::cout << "Error: --bundle needs a script file given with -f" << std::endl;
+				return 1;
+			}
+			return LuauUtils::writeBundle(scriptFilePath, source, bundlePath) ? 0 : 1;
+		}
 		
+		// analysis already compiled the modules it checked; otherwise compile them on every core before running
+		if (scriptFilePath != "" && !runAnalyzer && globalOptions.preload) {
+			DEBUG_LOG("Preloading modules...");
+			LuauUtils::precompiledChunks = std::make_unique<LuauUtils::PrecompiledChunks>();
+			LuauUtils::preloadRequireGraph(scriptFilePath, source, *LuauUtils::precompiledChunks);
+		}
+
 		DEBUG_LOG("Running script...");
-		runLuau(script);
+		LuauUtils::runLuau(source, scriptFilePath != "" && scriptFilePath != "-" ? "@" + scriptFilePath : "=script");
+		writeCoverage();
+
+		dumpCacheStats();
 
 	} catch (const std::exception& e) {
 		std::cout << "ERROR: " << e.what() << std::endl;
@@ -396,3 +379,4 @@ int main(int argc, char* argv[]) {
 
 	return 0;
 }
+